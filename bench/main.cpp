@@ -0,0 +1,451 @@
+/** ***********************************************************************************************
+ * @file main.cpp
+ * @brief viden_bench: throughput and latency of the players, the extraction, the image conversions
+ *        and the OpenCV kernels of viden, written as JSON for tracking across commits.
+ *
+ *        All assets are synthesized into a temporary directory, nothing has to be downloaded.
+ *        Usage: viden_bench [--output results.json] [--label <commit>] [--filter <regexp>]
+ *                           [--frames N] [--iterations N] [--size WxH] [--dir <work dir>]
+ */
+
+// Qt
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QThread>
+
+// cv
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+// oscv
+#include "ColorDef.h"
+#include "DftConvolver.h"
+#include "ImagePlayer.h"
+#include "ImageUtils.h"
+#include "OcvUtils.h"
+#include "PlayerMetrics.h"
+#include "VideoPlayer.h"
+#include "VideoUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace oscv;
+
+
+namespace
+{
+    const int BENCH_FORMAT_VERSION = 1;
+
+    struct Options
+    {
+        int frames;
+        int iterations;
+        cv::Size size;
+        QString workDir;
+        QRegularExpression filter;
+    };
+
+    inline double nowMs()
+    {
+        return std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //! Summary of latency samples in ms
+    QJsonObject latency(std::vector<double> samples)
+    {
+        QJsonObject o;
+        if ( samples.empty() ) {
+            return o;
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for ( double s: samples ) {
+            sum += s;
+        }
+        auto at = [&samples](double q) { return samples[ std::min(samples.size()-1, static_cast<size_t>(q*samples.size())) ]; };
+        o["n"] = static_cast<int>(samples.size());
+        o["mean_ms"] = sum / samples.size();
+        o["min_ms"] = samples.front();
+        o["p50_ms"] = at(0.50);
+        o["p90_ms"] = at(0.90);
+        o["p99_ms"] = at(0.99);
+        o["max_ms"] = samples.back();
+        return o;
+    }
+
+    //! Run fn iterations times after one warm up call
+    QJsonObject timeIt(int iterations, const std::function<void()>& fn)
+    {
+        fn();
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for ( int i=0; i<iterations; ++i ) {
+            double t0 = nowMs();
+            fn();
+            samples.push_back(nowMs() - t0);
+        }
+        return latency(samples);
+    }
+
+    QJsonObject stageStats(const PlayerMetrics::Snapshot& s, PlayerMetrics::Stage stage)
+    {
+        const PlayerMetrics::StageStats& st = s.stages[stage];
+        QJsonObject o;
+        o["n"] = static_cast<double>(st.count);
+        o["mean_ms"] = st.meanNs() / 1e6;
+        o["p50_ms"] = st.percentileNs(50) / 1e6;
+        o["p99_ms"] = st.percentileNs(99) / 1e6;
+        o["max_ms"] = st.maxNs / 1e6;
+        return o;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// Assets
+
+    //! Moving gradient with a moving disc and some noise, compresses like camera footage
+    cv::Mat synthFrame(int index, const cv::Size& size)
+    {
+        cv::Mat frame(size, CV_8UC3);
+        for ( int y=0; y<size.height; ++y ) {
+            cv::Vec3b* row = frame.ptr<cv::Vec3b>(y);
+            for ( int x=0; x<size.width; ++x ) {
+                row[x] = cv::Vec3b( static_cast<uchar>(x + index), static_cast<uchar>(y + 2*index),
+                                    static_cast<uchar>((x + y) / 2) );
+            }
+        }
+        cv::Point center( (index*7) % size.width, size.height/2 + static_cast<int>(size.height/4 * std::sin(index*0.1)) );
+        cv::circle(frame, center, size.height/8, cv::Scalar(40, 200, 255), -1);
+        cv::Mat noise(size, CV_8UC3);
+        cv::RNG rng(index);
+        rng.fill(noise, cv::RNG::NORMAL, 0, 6);
+        frame += noise;
+        return frame;
+    }
+
+    bool makeVideo(const QString& fileName, const Options& opt)
+    {
+        cv::VideoWriter writer( fileName.toStdString(), CV_FOURCC('M','J','P','G'),
+                                VideoDefs::DEFAULT_FRAME_RATE, opt.size );
+        if ( ! writer.isOpened() ) {
+            return false;
+        }
+        for ( int i=0; i<opt.frames; ++i ) {
+            writer.write( synthFrame(i, opt.size) );
+        }
+        return true;
+    }
+
+    //! img_0000.jpg ... in dir, returns the first file
+    QString makeSequence(const QString& dir, const Options& opt)
+    {
+        QDir().mkpath(dir);
+        QString first;
+        for ( int i=0; i<opt.frames; ++i ) {
+            QString name = QString("%1/img_%2.jpg").arg(dir).arg(i, 4, 10, QChar('0'));
+            if ( ! cv::imwrite(name.toStdString(), synthFrame(i, opt.size)) ) {
+                return QString();
+            }
+            if ( i == 0 ) {
+                first = name;
+            }
+        }
+        return first;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// Players
+
+    template<typename PLAYER>
+    QJsonObject benchPlayback(const QString& fileName)
+    {
+        QJsonObject o;
+        PLAYER player;
+        std::atomic<int> frames(0);
+        QObject::connect(&player, &PLAYER::newFrame, &player,
+                         [&frames](const QVariant&, int) { ++frames; }, Qt::DirectConnection);
+        if ( ! player.open(fileName) ) {
+            o["error"] = "open failed";
+            return o;
+        }
+        frames = 0;
+        player.setSpeed(IPlayer::Speed::Fast);
+        player.metrics().reset();
+        double t0 = nowMs();
+        player.play();
+        player.wait();  // run() ends behind the last frame
+        double elapsed = nowMs() - t0;
+
+        PlayerMetrics::Snapshot s = player.metrics().snapshot();
+        o["frames"] = frames.load();
+        o["seconds"] = elapsed / 1000;
+        o["fps"] = elapsed > 0 ? frames * 1000.0 / elapsed : 0.0;
+        o["decode"] = stageStats(s, PlayerMetrics::Decode);
+        o["wrap"] = stageStats(s, PlayerMetrics::Wrap);
+        o["emit"] = stageStats(s, PlayerMetrics::Emit);
+        o["cache_hits"] = static_cast<double>(s.counters[PlayerMetrics::CacheHits]);
+        o["cache_misses"] = static_cast<double>(s.counters[PlayerMetrics::CacheMisses]);
+        player.close();
+        return o;
+    }
+
+    //! Random jumps within the clip, each go() reads and emits the target frame
+    template<typename PLAYER>
+    QJsonObject benchSeek(const QString& fileName, int iterations)
+    {
+        QJsonObject o;
+        PLAYER player;
+        if ( ! player.open(fileName) ) {
+            o["error"] = "open failed";
+            return o;
+        }
+        int total = player.getNumberOfFrames();
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> target(0, std::max(0, total-2));
+        std::vector<double> samples;
+        for ( int i=0; i<iterations; ++i ) {
+            int relative = target(rng) - player.getCurrentFrame();
+            double t0 = nowMs();
+            bool ok = player.go(relative);
+            double t = nowMs() - t0;
+            if ( ok ) {
+                samples.push_back(t);
+            }
+        }
+        o = latency(samples);
+        o["failed"] = iterations - static_cast<int>(samples.size());
+        player.close();
+        return o;
+    }
+
+    QJsonObject benchVidToImg(const QString& video, const QString& dir, int frames)
+    {
+        QJsonObject o;
+        QDir(dir).removeRecursively();
+        QDir().mkpath(dir);
+        double t0 = nowMs();
+        bool ok = VideoUtils::VidToImg(video, dir, "x_");
+        double elapsed = nowMs() - t0;
+        o["ok"] = ok;
+        o["seconds"] = elapsed / 1000;
+        o["fps"] = elapsed > 0 ? frames * 1000.0 / elapsed : 0.0;
+        QDir(dir).removeRecursively();
+        return o;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// Conversions and kernels
+
+    QJsonObject benchConversion(const Options& opt)
+    {
+        QJsonObject o;
+        cv::Mat bgr = synthFrame(1, opt.size);
+        cv::Mat gray;
+        cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+        QImage img;
+        o["mat_to_qimage_bgr"] = timeIt(opt.iterations, [&]{ ImageUtils::MatToQImage(bgr, img); });
+        o["mat_to_qimage_gray"] = timeIt(opt.iterations, [&]{ ImageUtils::MatToQImage(gray, img); });
+        QImage rgb = ImageUtils::toQImage(bgr);
+        cv::Mat back;
+        o["qimage_to_mat_rgb"] = timeIt(opt.iterations, [&]{ back = ImageUtils::toMat(rgb); });
+        return o;
+    }
+
+    QJsonObject benchColorDef(const Options& opt)
+    {
+        QJsonObject o;
+        cv::Mat bgr = synthFrame(2, opt.size);
+        const int n = static_cast<int>(bgr.total());
+        const cv::Vec3b* px = bgr.ptr<cv::Vec3b>(0);
+        std::vector<cv::Vec3f> hsv(n);
+        volatile int sink = 0;
+        o["rgb2hsv"] = timeIt(opt.iterations, [&]{
+            for ( int i=0; i<n; ++i ) {
+                hsv[i] = ColorDef::rgb2hsv(px[i]);
+            }
+        });
+        o["hsv2rgb"] = timeIt(opt.iterations, [&]{
+            int s = 0;
+            for ( int i=0; i<n; ++i ) {
+                s += ColorDef::hsv2rgb(hsv[i])[0];
+            }
+            sink = s;
+        });
+        o["estimate_color_name"] = timeIt(opt.iterations, [&]{
+            int s = 0;
+            for ( int i=0; i<n; ++i ) {
+                s += static_cast<int>( ColorDef::estimateColorName(hsv[i]) );
+            }
+            sink = s;
+        });
+        (void)sink;
+        o["pixels"] = n;
+        return o;
+    }
+
+    QJsonObject benchOcvUtils(const Options& opt)
+    {
+        QJsonObject o;
+        cv::RNG rng(7);
+
+        cv::Mat_<ushort> img16(opt.size);
+        rng.fill(img16, cv::RNG::UNIFORM, 0, 4096);
+        cv::Mat_<uchar> stretched;
+        o["stretch_image_16u"] = timeIt(opt.iterations, [&]{ OcvUtils::stretchImage(img16, stretched); });
+
+        cv::Mat_<float> angles(opt.size);
+        rng.fill(angles, cv::RNG::UNIFORM, -100.0, 100.0);
+        cv::Mat_<float> trig;
+        o["cosine_32f"] = timeIt(opt.iterations, [&]{ OcvUtils::cosine(angles, trig); });
+        o["sine_32f"] = timeIt(opt.iterations, [&]{ OcvUtils::sine(angles, trig); });
+
+        cv::Mat spectrum(opt.size, CV_32FC2);
+        rng.fill(spectrum, cv::RNG::UNIFORM, -1.0, 1.0);
+        o["shift_dft"] = timeIt(opt.iterations, [&]{ OcvUtils::ShiftDft(spectrum); });
+
+        cv::Mat image(opt.size, CV_32F);
+        rng.fill(image, cv::RNG::UNIFORM, 0.0, 1.0);
+        cv::Mat kernel(31, 31, CV_32F);
+        rng.fill(kernel, cv::RNG::UNIFORM, 0.0, 1.0);
+        cv::Mat convolved;
+        o["convolve_dft_31x31"] = timeIt(opt.iterations, [&]{ OcvUtils::convolveDFT(image, kernel, convolved); });
+
+        DftConvolver convolver;
+        convolver.setKernel(kernel);
+        o["dft_convolver_31x31"] = timeIt(opt.iterations, [&]{ convolver.apply(image, convolved); });
+        return o;
+    }
+
+    QJsonObject systemInfo()
+    {
+        QJsonObject o;
+        o["os"] = QSysInfo::prettyProductName();
+        o["cpu"] = QSysInfo::currentCpuArchitecture();
+        o["threads"] = QThread::idealThreadCount();
+        o["opencv"] = QString::fromLatin1(CV_VERSION);
+        o["opencv_threads"] = cv::getNumThreads();
+        o["qt"] = QString::fromLatin1(qVersion());
+        return o;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    // VideoUtils::VidToImg processes events, a display is not needed for that
+    if ( qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") ) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("viden_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks of the viden library, results as JSON");
+    parser.addHelpOption();
+    QCommandLineOption outputOpt("output", "Write the JSON to <file> instead of stdout.", "file");
+    QCommandLineOption labelOpt("label", "Label of this run, e.g. the commit.", "label");
+    QCommandLineOption filterOpt("filter", "Run only the benchmarks matching <regexp>.", "regexp", ".*");
+    QCommandLineOption framesOpt("frames", "Frames of the synthesized clips.", "N", "200");
+    QCommandLineOption iterOpt("iterations", "Iterations of the micro benchmarks and seeks.", "N", "30");
+    QCommandLineOption sizeOpt("size", "Frame size of the synthesized assets.", "WxH", "1280x720");
+    QCommandLineOption dirOpt("dir", "Work directory for the assets, a temporary one by default.", "dir");
+    parser.addOptions( QList<QCommandLineOption>() << outputOpt << labelOpt << filterOpt << framesOpt
+                                                   << iterOpt << sizeOpt << dirOpt );
+    parser.process(app);
+
+    Options opt;
+    opt.frames = std::max(2, parser.value(framesOpt).toInt());
+    opt.iterations = std::max(1, parser.value(iterOpt).toInt());
+    QStringList wh = parser.value(sizeOpt).split('x');
+    opt.size = cv::Size( wh.size() == 2 ? std::max(16, wh[0].toInt()) : 1280,
+                         wh.size() == 2 ? std::max(16, wh[1].toInt()) : 720 );
+    opt.filter = QRegularExpression( parser.value(filterOpt) );
+
+    QTemporaryDir tmp;
+    opt.workDir = parser.isSet(dirOpt) ? parser.value(dirOpt) : tmp.path();
+    QDir().mkpath(opt.workDir);
+    auto selected = [&opt](const char* name) { return opt.filter.match(QLatin1String(name)).hasMatch(); };
+
+    QJsonObject results;
+    QString video = opt.workDir + "/bench.avi";
+    QString sequence;
+    double t0 = nowMs();
+    bool haveVideo = makeVideo(video, opt);
+    sequence = makeSequence(opt.workDir + "/seq", opt);
+    QJsonObject assets;
+    assets["video"] = haveVideo;
+    assets["sequence"] = ! sequence.isEmpty();
+    assets["seconds"] = (nowMs() - t0) / 1000;
+
+    if ( haveVideo && selected("video_playback") ) {
+        results["video_playback"] = benchPlayback<VideoPlayer>(video);
+    }
+    if ( haveVideo && selected("video_seek") ) {
+        results["video_seek"] = benchSeek<VideoPlayer>(video, opt.iterations);
+    }
+    if ( ! sequence.isEmpty() && selected("image_playback") ) {
+        results["image_playback"] = benchPlayback<ImagePlayer>(sequence);
+    }
+    if ( ! sequence.isEmpty() && selected("image_seek") ) {
+        results["image_seek"] = benchSeek<ImagePlayer>(sequence, opt.iterations);
+    }
+    if ( haveVideo && selected("vid_to_img") ) {
+        results["vid_to_img"] = benchVidToImg(video, opt.workDir + "/extract", opt.frames);
+    }
+    if ( selected("conversion") ) {
+        results["conversion"] = benchConversion(opt);
+    }
+    if ( selected("color_def") ) {
+        results["color_def"] = benchColorDef(opt);
+    }
+    if ( selected("ocv_utils") ) {
+        results["ocv_utils"] = benchOcvUtils(opt);
+    }
+
+    QJsonObject config;
+    config["frames"] = opt.frames;
+    config["iterations"] = opt.iterations;
+    config["width"] = opt.size.width;
+    config["height"] = opt.size.height;
+
+    QJsonObject root;
+    root["format_version"] = BENCH_FORMAT_VERSION;
+    root["label"] = parser.value(labelOpt);
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["system"] = systemInfo();
+    root["config"] = config;
+    root["assets"] = assets;
+    root["results"] = results;
+    QByteArray json = QJsonDocument(root).toJson();
+
+    if ( parser.isSet(outputOpt) ) {
+        QFile file( parser.value(outputOpt) );
+        if ( ! file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size() ) {
+            std::fprintf(stderr, "viden_bench: cannot write %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+    }
+    else {
+        std::fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    return haveVideo && ! sequence.isEmpty() ? 0 : 2;
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -3,7 +3,6 @@
 
 #include <QString>
 #include "Definitions.h"
-#include "Player.h"
 #include "VideoDefs.h"
 #include "ImageDefs.h"
 #include <QFileInfo>
@@ -72,6 +71,7 @@ namespace oscv
      * @param all true if count all images regardless of starting image sequence.
      *            false if count number of images from the given image to the last in the sequence.
      * @return number of files in the given folder with similar prefix and suffix
+     * @see SequenceIndex for sequences with gaps and for repeated lookups, this scans the folder on every call.
      */
     static int getNumberOfSequences(const QString& filename, int digits = 4, bool all=true)
     {
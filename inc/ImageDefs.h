@@ -40,7 +40,7 @@ public:
      * @brief getSupportFormats list of image formats (extensions of file)
      * @return set of strings for identify the image format such as
      *         "bmp", "png", "tif", "tiff", "jpeg", "jpg", "jp2", "ppm",
-     *         "pbm", "ppm", "sr" and "ras".
+     *         "pbm", "ppm", "sr", "ras" and the native "vraw" (@see RawFrame).
      */
     static QSet<QString> getSupportFormats();
 
@@ -18,6 +18,7 @@
 namespace oscv
 {
 class IProgressBar;
+class HashIndex;
 
 /**
  * @brief The VideoUtils class Video utilities functions
@@ -37,11 +38,16 @@ public:
      * \param[in] progress progress dialog for the user interface. It is set to NULL if the caller
      *            does not care for the progress but only want to attain output. The caller is
      *            the owner of the object and has the responsibility to delete the IProgressBar object.
+     * \param[in] skipStatic write only frames which differ from the last written one, see ChangeGate.
+     *            The file names keep the frame numbers, static stretches leave gaps.
+     * \param[out] hashes if not NULL, a clip vidFile is added with the FrameHash of each written frame
     */
     static bool VidToImg(const QString& vidFile,
                          const QString& imgDir,
                          const QString& imgPrefix,
-                         IProgressBar* progress=NULL);
+                         IProgressBar* progress=NULL,
+                         bool skipStatic=false,
+                         HashIndex* hashes=NULL);
 
     /*! Get frame rate per second (e.g.PAL = 25fps)
      */
@@ -0,0 +1,336 @@
+#include "AsyncFileReader.h"
+
+// Qt
+#include <QFile>
+
+// oscv
+#include "Tracer.h"
+
+#include <algorithm>
+
+#if defined (VIDEN_HAVE_IO_URING)
+#include <liburing.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdint>
+#endif
+
+using namespace oscv;
+
+
+#if defined (VIDEN_HAVE_IO_URING)
+struct AsyncFileReader::Ring
+{
+    struct io_uring ring;
+    int wakeFd;          // eventfd, its read completes when the reader has to look at the queue
+    uint64_t wakeValue;
+};
+#else
+struct AsyncFileReader::Ring
+{
+};
+#endif
+
+
+AsyncFileReader::AsyncFileReader(int queueDepth)
+    : m_queueDepth(std::max(1, queueDepth))
+    , m_backend(Backend::ThreadPool)
+    , m_stop(false)
+{
+    start();
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    stop();
+}
+
+bool AsyncFileReader::request(int key, const QString& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if ( m_stop || m_requests.count(key) || static_cast<int>(m_requests.size()) >= m_queueDepth ) {
+        return false;
+    }
+    RequestPtr req = std::make_shared<Request>();
+    req->key = key;
+    req->path = path;
+    req->done = 0;
+    req->fd = -1;
+    req->finished = false;
+    req->ok = false;
+    req->cancelled = false;
+    m_requests[key] = req;
+    m_queue.push_back(req);
+#if defined (VIDEN_HAVE_IO_URING)
+    if ( m_ring ) {
+        uint64_t one = 1;
+        ssize_t n = write(m_ring->wakeFd, &one, sizeof(one));
+        (void)n;
+        return true;
+    }
+#endif
+    m_tasks.run([this]{ readNext(); });
+    return true;
+}
+
+bool AsyncFileReader::take(int key, Buffer& data)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::map<int, RequestPtr>::iterator it = m_requests.find(key);
+    if ( it == m_requests.end() ) {
+        return false;
+    }
+    RequestPtr req = it->second;
+    m_finished.wait(lock, [&req]{ return req->finished; });
+    m_requests.erase(key);
+    data.swap(req->data);
+    return req->ok;
+}
+
+bool AsyncFileReader::isPending(int key) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requests.count(key) > 0;
+}
+
+void AsyncFileReader::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for ( std::map<int, RequestPtr>::iterator it = m_requests.begin(); it != m_requests.end(); ++it )
+    {
+        Request& req = *it->second;
+        req.cancelled = true;
+        if ( req.finished && ! req.data.empty() ) {
+            m_pool.push_back(Buffer());
+            m_pool.back().swap(req.data);
+        }
+    }
+    // not started yet: dropped here, in flight: the reading thread recycles the buffer when done
+    m_queue.clear();
+    m_requests.clear();
+}
+
+void AsyncFileReader::recycle(Buffer& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if ( static_cast<int>(m_pool.size()) < 2*m_queueDepth ) {
+        m_pool.push_back(Buffer());
+        m_pool.back().swap(data);
+    }
+    data.clear();
+}
+
+void AsyncFileReader::setQueueDepth(int depth)
+{
+    depth = std::max(1, depth);
+    if ( depth == m_queueDepth ) {
+        return;
+    }
+    stop();
+    m_queueDepth = depth;
+    start();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AsyncFileReader::start()
+{
+    m_stop = false;
+    m_backend = Backend::ThreadPool;
+
+#if defined (VIDEN_HAVE_IO_URING)
+    std::unique_ptr<Ring> ring(new Ring);
+    ring->wakeFd = eventfd(0, EFD_CLOEXEC);
+    if ( ring->wakeFd >= 0 ) {
+        // one more entry for the read of the eventfd
+        if ( io_uring_queue_init(m_queueDepth+1, &ring->ring, 0) == 0 ) {
+            m_ring = std::move(ring);
+            m_backend = Backend::IoUring;
+            m_threads.push_back( std::thread(&AsyncFileReader::ioUringLoop, this) );
+            return;
+        }
+        close(ring->wakeFd);
+    }
+#endif
+
+    // e.g. kernel without io_uring or blocked by seccomp: request() submits a read task per file
+}
+
+void AsyncFileReader::stop()
+{
+    cancel();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+#if defined (VIDEN_HAVE_IO_URING)
+    if ( m_ring ) {
+        uint64_t one = 1;
+        ssize_t n = write(m_ring->wakeFd, &one, sizeof(one));
+        (void)n;
+    }
+#endif
+    for ( size_t i=0; i<m_threads.size(); ++i ) {
+        m_threads[i].join();
+    }
+    m_threads.clear();
+    m_tasks.wait(); // tasks of cancelled requests find the queue empty and return
+#if defined (VIDEN_HAVE_IO_URING)
+    if ( m_ring ) {
+        io_uring_queue_exit(&m_ring->ring);
+        close(m_ring->wakeFd);
+    }
+#endif
+    m_ring.reset();
+    m_pool.clear();
+}
+
+void AsyncFileReader::readNext()
+{
+    RequestPtr req;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ( m_stop || m_queue.empty() ) {
+            return;
+        }
+        req = m_queue.front();
+        m_queue.pop_front();
+        req->data = takeBuffer();
+    }
+
+    VIDEN_TRACE_SCOPE("read");
+    bool ok = false;
+    QFile file(req->path);
+    if ( file.open(QIODevice::ReadOnly) ) {
+        qint64 size = file.size();
+        req->data.resize( static_cast<size_t>(size) );
+        ok = size == 0 || file.read( reinterpret_cast<char*>(req->data.data()), size ) == size;
+    }
+    finish(req, ok);
+}
+
+void AsyncFileReader::ioUringLoop()
+{
+#if defined (VIDEN_HAVE_IO_URING)
+    VIDEN_TRACE_THREAD_NAME("AsyncFileReader");
+    struct io_uring* ring = &m_ring->ring;
+    std::vector<RequestPtr> inFlight;   // keeps the requests alive, user data of the entries are raw pointers
+    bool armed = false;
+
+    while ( true )
+    {
+        std::vector<RequestPtr> started;
+        bool stopping;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            stopping = m_stop;
+            while ( ! stopping && ! m_queue.empty()
+                    && static_cast<int>(inFlight.size() + started.size()) < m_queueDepth )
+            {
+                started.push_back(m_queue.front());
+                m_queue.pop_front();
+                started.back()->data = takeBuffer();
+            }
+        }
+        if ( stopping && inFlight.empty() ) {
+            break;
+        }
+
+        // open and size synchronously, these are cheap compared to the read of the content
+        for ( size_t i=0; i<started.size(); ++i )
+        {
+            RequestPtr& req = started[i];
+            req->fd = open(QFile::encodeName(req->path).constData(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if ( req->fd < 0 || fstat(req->fd, &st) != 0 ) {
+                finish(req, false);
+                continue;
+            }
+            req->data.resize( static_cast<size_t>(st.st_size) );
+            if ( req->data.empty() ) {
+                finish(req, true);
+                continue;
+            }
+            struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+            io_uring_prep_read(sqe, req->fd, req->data.data(), static_cast<unsigned>(req->data.size()), 0);
+            io_uring_sqe_set_data(sqe, req.get());
+            inFlight.push_back(req);
+        }
+        if ( ! armed && ! stopping ) {
+            struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+            io_uring_prep_read(sqe, m_ring->wakeFd, &m_ring->wakeValue, sizeof(m_ring->wakeValue), 0);
+            io_uring_sqe_set_data(sqe, nullptr);
+            armed = true;
+        }
+        io_uring_submit(ring);
+
+        struct io_uring_cqe* cqe;
+        if ( io_uring_wait_cqe(ring, &cqe) < 0 ) {
+            continue; // e.g. EINTR
+        }
+        do
+        {
+            Request* done = static_cast<Request*>( io_uring_cqe_get_data(cqe) );
+            int res = cqe->res;
+            io_uring_cqe_seen(ring, cqe);
+            if ( done == nullptr ) {
+                armed = false;
+                continue;
+            }
+            if ( res > 0 ) {
+                done->done += static_cast<size_t>(res);
+            }
+            if ( res > 0 && done->done < done->data.size() ) {
+                // short read, e.g. on network file systems: continue behind the read bytes
+                struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+                io_uring_prep_read(sqe, done->fd, done->data.data() + done->done,
+                                   static_cast<unsigned>(done->data.size() - done->done), done->done);
+                io_uring_sqe_set_data(sqe, done);
+                io_uring_submit(ring);
+                continue;
+            }
+            std::vector<RequestPtr>::iterator it = std::find_if(inFlight.begin(), inFlight.end(),
+                                                                [done](const RequestPtr& r){ return r.get() == done; });
+            RequestPtr req = *it;
+            inFlight.erase(it);
+            finish(req, res >= 0 && req->done == req->data.size());
+        }
+        while ( io_uring_peek_cqe(ring, &cqe) == 0 );
+    }
+#endif
+}
+
+void AsyncFileReader::finish(const RequestPtr& req, bool ok)
+{
+#if defined (VIDEN_HAVE_IO_URING)
+    if ( req->fd >= 0 ) {
+        close(req->fd);
+        req->fd = -1;
+    }
+#endif
+    std::lock_guard<std::mutex> lock(m_mutex);
+    req->ok = ok;
+    req->finished = true;
+    if ( req->cancelled && static_cast<int>(m_pool.size()) < 2*m_queueDepth ) {
+        m_pool.push_back(Buffer());
+        m_pool.back().swap(req->data);
+    }
+    m_finished.notify_all();
+}
+
+// Called with m_mutex locked
+AsyncFileReader::Buffer AsyncFileReader::takeBuffer()
+{
+    Buffer buffer;
+    if ( ! m_pool.empty() ) {
+        buffer.swap(m_pool.back());
+        m_pool.pop_back();
+    }
+    return buffer;
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
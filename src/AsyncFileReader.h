@@ -0,0 +1,167 @@
+#ifndef ASYNCFILEREADER_H
+#define ASYNCFILEREADER_H
+
+/** ***********************************************************************************************
+ * @file AsyncFileReader.h
+ * @brief Asynchronous reading of whole files into pooled buffers, e.g. the encoded frames of an
+ *        image sequence ahead of the playback.
+ */
+
+// Qt
+#include <QString>
+
+// oscv
+#include "Executor.h"
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The AsyncFileReader class reads files in the background, requests are identified by a key.
+ *
+ *        With io_uring (Linux, built with liburing, see VIDEN_WITH_IO_URING) one thread opens the
+ *        files and keeps up to queueDepth reads in flight in the kernel. Otherwise the files are read
+ *        with blocking calls in tasks of the shared Executor, at most queueDepth at a time. The bytes go into buffers from a pool, hand
+ *        them back with recycle() after decoding so that steady state reading does not allocate.
+ */
+class AsyncFileReader
+{
+public:
+    typedef std::vector<unsigned char> Buffer;
+
+    enum class Backend { ThreadPool=0, IoUring };
+
+    static const int DEFAULT_QUEUE_DEPTH = 4;
+
+    explicit AsyncFileReader(int queueDepth=DEFAULT_QUEUE_DEPTH);
+
+    ~AsyncFileReader();
+
+    /**
+     * @brief request queue the reading of a file
+     * @param key identifies the request, e.g. the frame number
+     * @param path file with path
+     * @return false if a request with this key is pending or queueDepth requests are pending.
+     */
+    bool request(int key, const QString& path);
+
+    /**
+     * @brief take wait for the request with the given key and hand out its bytes
+     * @param key
+     * @param data[out] content of the file. Give it back with recycle().
+     * @return false if there is no such request or the file could not be read.
+     */
+    bool take(int key, Buffer& data);
+
+    /**
+     * @brief isPending
+     * @param key
+     * @return true if the request has been made and not been taken or cancelled yet
+     */
+    bool isPending(int key) const;
+
+    /**
+     * @brief cancel drop all pending requests, e.g. after a seek. Reads in flight finish in the background.
+     */
+    void cancel();
+
+    /**
+     * @brief recycle give a buffer back to the pool
+     * @param data buffer from take(), empty afterwards
+     */
+    void recycle(Buffer& data);
+
+    /**
+     * @brief setQueueDepth maximum number of pending requests. Cancels all requests.
+     * @param depth at least 1
+     */
+    void setQueueDepth(int depth);
+
+    inline int queueDepth() const;
+
+    inline Backend backend() const;
+
+    /**
+     * @brief setPriority executor priority class of the reads of the thread pool backend
+     */
+    inline void setPriority(Executor::Priority priority);
+
+    inline Executor::Priority priority() const;
+
+
+private:
+    struct Request
+    {
+        int key;
+        QString path;
+        Buffer data;
+        size_t done;   // bytes read
+        int fd;
+        bool finished;
+        bool ok;
+        bool cancelled;
+    };
+    typedef std::shared_ptr<Request> RequestPtr;
+
+    void start();
+
+    void stop();
+
+    //! Task of the thread pool backend, reads the oldest queued request
+    void readNext();
+
+    void ioUringLoop();
+
+    void finish(const RequestPtr& req, bool ok);
+
+    Buffer takeBuffer();
+
+
+    int m_queueDepth;
+    Backend m_backend;
+    bool m_stop;
+    std::map<int, RequestPtr> m_requests; // pending, not taken yet
+    std::deque<RequestPtr> m_queue;       // not started yet
+    std::vector<Buffer> m_pool;
+    std::vector<std::thread> m_threads;   // io_uring thread
+    TaskGroup m_tasks;                    // reads of the thread pool backend
+    mutable std::mutex m_mutex;
+    std::condition_variable m_finished;
+
+    struct Ring;
+    std::unique_ptr<Ring> m_ring;         // io_uring state, null with the thread pool
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+int AsyncFileReader::queueDepth() const
+{
+    return m_queueDepth;
+}
+
+AsyncFileReader::Backend AsyncFileReader::backend() const
+{
+    return m_backend;
+}
+
+void AsyncFileReader::setPriority(Executor::Priority priority)
+{
+    m_tasks.setPriority(priority);
+}
+
+Executor::Priority AsyncFileReader::priority() const
+{
+    return m_tasks.priority();
+}
+
+}
+#endif // ASYNCFILEREADER_H
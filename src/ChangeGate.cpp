@@ -0,0 +1,89 @@
+#include "ChangeGate.h"
+
+// cv
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+ChangeGate::ChangeGate(double threshold, int keepAlive)
+    : m_threshold(threshold)
+    , m_keepAlive(0)
+    , m_thumbnailWidth(DEFAULT_THUMBNAIL_WIDTH)
+    , m_sinceLastPass(0)
+    , m_passed(0)
+    , m_suppressed(0)
+    , m_lastDifference(0.0)
+    , m_hasReference(false)
+{
+    setKeepAlive(keepAlive);
+}
+
+bool ChangeGate::accept(const cv::Mat& frame)
+{
+    if ( frame.empty() ) {
+        return false;
+    }
+    shrink(frame);
+
+    bool pass = ! m_hasReference || m_current.size() != m_reference.size();
+    if ( pass ) {
+        m_lastDifference = 0.0;
+    }
+    else {
+        m_lastDifference = cv::norm(m_current, m_reference, cv::NORM_L1) / m_current.total();
+        pass = m_lastDifference >= m_threshold || (m_keepAlive > 0 && m_sinceLastPass >= m_keepAlive);
+    }
+
+    if ( ! pass ) {
+        m_sinceLastPass++;
+        m_suppressed++;
+        return false;
+    }
+    cv::swap(m_current, m_reference); // the old reference becomes the next thumbnail buffer
+    m_hasReference = true;
+    m_sinceLastPass = 0;
+    m_passed++;
+    return true;
+}
+
+void ChangeGate::reset()
+{
+    m_hasReference = false;
+    m_sinceLastPass = 0;
+    m_lastDifference = 0.0;
+    m_toneMapper.reset();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ChangeGate::shrink(const cv::Mat& frame)
+{
+    int width = std::min(m_thumbnailWidth, frame.cols);
+    int height = std::max(1, cvRound(static_cast<double>(frame.rows) * width / frame.cols));
+    cv::resize(frame, m_small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    // 8 bit frames go straight into the thumbnail, the others through m_gray and the tone mapping
+    const bool map = ToneMapper::isNeeded(m_small);
+    cv::Mat& gray = map ? m_gray : m_current;
+    switch ( m_small.channels() )
+    {
+    case 3:
+        cv::cvtColor(m_small, gray, CV_BGR2GRAY);
+        break;
+    case 4:
+        cv::cvtColor(m_small, gray, CV_BGRA2GRAY);
+        break;
+    default:
+        m_small.copyTo(gray);
+        break;
+    }
+    if ( map ) {
+        m_toneMapper.map(m_gray, m_current); // the range of the values, not only the high byte
+    }
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
@@ -0,0 +1,146 @@
+#ifndef CHANGEGATE_H
+#define CHANGEGATE_H
+
+/** ***********************************************************************************************
+ * @file ChangeGate.h
+ * @brief Suppression of static frames, e.g. of surveillance clips, before they are emitted or written.
+ */
+
+// cv
+#include <opencv2/core/core.hpp>
+
+// oscv
+#include "ToneMapper.h"
+
+
+namespace oscv
+{
+
+/**
+ * @brief The ChangeGate class lets a frame pass only if it differs enough from the last frame which
+ *        passed.
+ *
+ *        The frames are shrunk to a small grey thumbnail (INTER_AREA averages out sensor noise) and
+ *        compared by the mean absolute difference of the thumbnail pixels (SAD / pixels), in grey
+ *        levels. Comparing against the last passed frame instead of the previous frame catches slow
+ *        changes too, they add up until the threshold is reached. A keep-alive lets a frame pass after
+ *        a number of suppressed frames, so the consumer sees the scene is still alive.
+ *        @code
+ *        ChangeGate gate(2.0, 250);
+ *        if ( gate.accept(frame) ) {
+ *            process(frame);
+ *        }
+ *        @endcode
+ *        16 bit and float frames are mapped to grey levels by the range of their values (@see ToneMapper),
+ *        so the threshold means the same for all depths.
+ *        The thumbnails are reused, accept() does not allocate after the first frame.
+ */
+class ChangeGate
+{
+public:
+    static const int DEFAULT_THUMBNAIL_WIDTH = 64;
+
+    /**
+     * @brief ChangeGate
+     * @param threshold mean absolute difference in grey levels (0..255) a frame needs to pass
+     * @param keepAlive pass a frame after this many suppressed ones, 0 never
+     */
+    explicit ChangeGate(double threshold=2.0, int keepAlive=0);
+
+    /**
+     * @brief accept decide if the frame is emitted. The first frame and the first one after reset()
+     *        always pass.
+     * @param frame BGR or grey image
+     * @return true if the frame changed enough or the keep-alive is due
+     */
+    bool accept(const cv::Mat& frame);
+
+    //! The next frame passes, e.g. after a seek
+    void reset();
+
+    inline void setThreshold(double threshold);
+
+    inline double threshold() const;
+
+    inline void setKeepAlive(int frames);
+
+    inline int keepAlive() const;
+
+    /**
+     * @brief setThumbnailWidth width of the compared thumbnails, the height keeps the aspect ratio.
+     *        Smaller is faster and less sensitive to small moving objects. The next frame passes.
+     * @param width at least 8
+     */
+    inline void setThumbnailWidth(int width);
+
+    //! Difference computed by the last accept(), 0 for the first frame
+    inline double lastDifference() const;
+
+    inline int passed() const;
+
+    inline int suppressed() const;
+
+private:
+    //! Thumbnail of frame into m_current
+    void shrink(const cv::Mat& frame);
+
+    double m_threshold;
+    int m_keepAlive;
+    int m_thumbnailWidth;
+    int m_sinceLastPass;
+    int m_passed;
+    int m_suppressed;
+    double m_lastDifference;
+    bool m_hasReference;
+
+    cv::Mat m_small;      // frame at thumbnail size, before the colour conversion
+    cv::Mat m_gray;       // grey thumbnail of a 16 bit or float frame, before the mapping
+    cv::Mat m_current;    // CV_8UC1 thumbnail of the frame
+    cv::Mat m_reference;  // thumbnail of the last passed frame
+    ToneMapper m_toneMapper;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+void ChangeGate::setThreshold(double threshold)
+{
+    m_threshold = threshold;
+}
+
+double ChangeGate::threshold() const
+{
+    return m_threshold;
+}
+
+void ChangeGate::setKeepAlive(int frames)
+{
+    m_keepAlive = frames > 0 ? frames : 0;
+}
+
+int ChangeGate::keepAlive() const
+{
+    return m_keepAlive;
+}
+
+void ChangeGate::setThumbnailWidth(int width)
+{
+    m_thumbnailWidth = width > 8 ? width : 8;
+}
+
+double ChangeGate::lastDifference() const
+{
+    return m_lastDifference;
+}
+
+int ChangeGate::passed() const
+{
+    return m_passed;
+}
+
+int ChangeGate::suppressed() const
+{
+    return m_suppressed;
+}
+
+}
+#endif // CHANGEGATE_H
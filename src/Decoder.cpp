@@ -0,0 +1,29 @@
+#include "Decoder.h"
+
+// oscv
+#include "FileUtils.h"
+#include "VideoDecoder.h"
+#include "ImageSequenceDecoder.h"
+
+using namespace oscv;
+
+
+std::unique_ptr<IDecoder> IDecoder::create(const QString& filename)
+{
+    std::unique_ptr<IDecoder> decoder;
+    switch ( filePlayerType(filename) )
+    {
+    case FilePlayerType::Image:
+        decoder.reset(new ImageSequenceDecoder);
+        break;
+    default: // cv::VideoCapture also opens streams and files with unlisted extensions
+        decoder.reset(new VideoDecoder);
+        break;
+    }
+    if ( ! decoder->open(filename) ) {
+        decoder.reset();
+    }
+    return decoder;
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,83 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+/** ***********************************************************************************************
+ * @file Decoder.h
+ * @brief Interface of the frame sources of the core engine: video files and image sequences.
+ *        Depends on OpenCV and QtCore only, no event loop or display is needed.
+ */
+
+// Qt
+#include <QString>
+
+// cv
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The IDecoder class Sequential, seekable access to the frames of a video or an image sequence.
+ *
+ *        Frames are numbered from 0. A decoder is not thread safe, it is used by one thread at a time.
+ */
+class IDecoder
+{
+public:
+    virtual ~IDecoder() {}
+
+    /**
+     * @brief open
+     * @param filename video file or any image of a sequence
+     * @return false if the file cannot be opened
+     */
+    virtual bool open(const QString& filename) = 0;
+
+    virtual void close() = 0;
+
+    virtual bool isOpen() const = 0;
+
+    /**
+     * @brief read decode the frame at position() and advance to the next one
+     * @param frame[out] BGR image, reuses the buffer of frame if it has the right size and type
+     * @return false behind the last frame or if decoding failed
+     */
+    virtual bool read(cv::Mat& frame) = 0;
+
+    /**
+     * @brief grab advance to the next frame without decoding the current one
+     * @return false behind the last frame
+     */
+    virtual bool grab() = 0;
+
+    /**
+     * @brief seek set the frame which the next read() returns
+     * @param frameNumber 0..frameCount()-1
+     * @return false if frameNumber is out of range or the source cannot seek there
+     */
+    virtual bool seek(int frameNumber) = 0;
+
+    //! Number of the frame which the next read() returns
+    virtual int position() const = 0;
+
+    virtual int frameCount() const = 0;
+
+    virtual double frameRate() const = 0;
+
+    //! Opened video file, or the image file of the last read frame
+    virtual QString name() const = 0;
+
+    /**
+     * @brief create decoder for the type of the given file, @see filePlayerType(). Files which are
+     *        not images are opened as videos.
+     * @param filename video file, stream or image
+     * @return opened decoder, null if the file cannot be opened
+     */
+    static std::unique_ptr<IDecoder> create(const QString& filename);
+};
+
+}
+#endif // DECODER_H
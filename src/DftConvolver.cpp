@@ -0,0 +1,235 @@
+#include "DftConvolver.h"
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+/**
+ * @brief The DftConvolver::TileBody class convolves a range of tiles, each worker with its own scratch
+ */
+class DftConvolver::TileBody : public cv::ParallelLoopBody
+{
+public:
+    TileBody(DftConvolver& convolver, const cv::Mat& in, cv::Mat& out, const cv::Size& tileSize, int tilesX)
+        : m_convolver(convolver)
+        , m_in(in)
+        , m_out(out)
+        , m_tileSize(tileSize)
+        , m_tilesX(tilesX)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        std::shared_ptr<TileScratch> scratch = m_convolver.acquireScratch();
+        for ( int i=range.start; i<range.end; ++i ) {
+            cv::Rect tile( (i % m_tilesX)*m_tileSize.width, (i / m_tilesX)*m_tileSize.height,
+                           m_tileSize.width, m_tileSize.height );
+            tile &= cv::Rect(0, 0, m_in.cols, m_in.rows);
+            m_convolver.convolveTile(m_in, m_out, tile, *scratch);
+        }
+        m_convolver.releaseScratch(scratch);
+    }
+
+private:
+    DftConvolver& m_convolver;
+    const cv::Mat& m_in;
+    cv::Mat& m_out;
+    cv::Size m_tileSize;
+    int m_tilesX;
+};
+
+
+DftConvolver::DftConvolver()
+    : m_method(Method::Auto)
+    , m_tileSize(DEFAULT_TILE_SIZE)
+{
+}
+
+DftConvolver::DftConvolver(const cv::Mat& kernel, Method method)
+    : m_method(method)
+    , m_tileSize(DEFAULT_TILE_SIZE)
+{
+    setKernel(kernel);
+}
+
+bool DftConvolver::setKernel(const cv::Mat& kernel)
+{
+    if ( kernel.empty() || kernel.channels() != 1 ) {
+        return false;
+    }
+    int depth = ( kernel.depth() == CV_64F )? CV_64F : CV_32F;
+    kernel.convertTo(m_kernel, depth);
+    cv::flip(m_kernel, m_flipped, -1);
+    m_anchor = cv::Point(m_kernel.cols/2, m_kernel.rows/2);
+    clear();
+    return true;
+}
+
+void DftConvolver::clear()
+{
+    m_plans.clear();
+    m_tileDftSize = cv::Size();
+    m_tileKernelSpectrum.release();
+    std::lock_guard<std::mutex> locker(m_scratchMutex);
+    m_freeScratch.clear();
+}
+
+void DftConvolver::setTileSize(int tileSize)
+{
+    if ( tileSize != m_tileSize ) {
+        m_tileSize = tileSize;
+        clear();
+    }
+}
+
+DftConvolver::Method DftConvolver::resolveMethod(const cv::Size& imgSize) const
+{
+    if ( m_method != Method::Auto ) {
+        return m_method;
+    }
+    if ( m_kernel.total() <= static_cast<size_t>(DIRECT_KERNEL_AREA) ) {
+        return Method::Direct;
+    }
+    return ( imgSize.area() > TILED_MIN_AREA )? Method::Tiled : Method::Dft;
+}
+
+bool DftConvolver::apply(const cv::Mat& in, cv::Mat& out)
+{
+    if ( m_kernel.empty() || in.empty() || in.channels() != 1 ) {
+        return false;
+    }
+    switch ( resolveMethod(in.size()) ) {
+        case Method::Direct: applyDirect(in, out); break;
+        case Method::Tiled:  applyTiled(in, out); break;
+        default:             applyDft(in, out); break;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DftConvolver::Plan& DftConvolver::plan(const cv::Size& imgSize)
+{
+    for ( size_t i=0; i<m_plans.size(); ++i ) {
+        if ( m_plans[i].imgSize == imgSize ) {
+            std::rotate(m_plans.begin(), m_plans.begin()+i, m_plans.begin()+i+1);
+            return m_plans.front();
+        }
+    }
+    if ( m_plans.size() >= static_cast<size_t>(MAX_PLANS) ) {
+        m_plans.pop_back();
+    }
+
+    // Linear convolution needs at least image + kernel - 1 samples to avoid circular wrap around
+    Plan p;
+    p.imgSize = imgSize;
+    p.dftSize = cv::Size( cv::getOptimalDFTSize(imgSize.width + m_kernel.cols - 1),
+                          cv::getOptimalDFTSize(imgSize.height + m_kernel.rows - 1) );
+    int depth = m_kernel.depth();
+    cv::Mat paddedKernel = cv::Mat::zeros(p.dftSize, depth);
+    m_kernel.copyTo( paddedKernel(cv::Rect(0, 0, m_kernel.cols, m_kernel.rows)) );
+    cv::dft(paddedKernel, p.kernelSpectrum, 0, m_kernel.rows);
+
+    p.padded = cv::Mat::zeros(p.dftSize, depth);
+    p.spectrum.create(p.dftSize, depth);
+    p.product.create(p.dftSize, depth);
+    p.result.create(p.dftSize, depth);
+
+    m_plans.insert(m_plans.begin(), p);
+    return m_plans.front();
+}
+
+void DftConvolver::applyDirect(const cv::Mat& in, cv::Mat& out)
+{
+    // filter2D correlates, so the flipped kernel gives the convolution. Its anchor is mirrored too.
+    cv::Point anchor(m_kernel.cols-1-m_anchor.x, m_kernel.rows-1-m_anchor.y);
+    cv::filter2D(in, out, m_kernel.depth(), m_flipped, anchor, 0, cv::BORDER_CONSTANT);
+}
+
+void DftConvolver::applyDft(const cv::Mat& in, cv::Mat& out)
+{
+    Plan& p = plan(in.size());
+    cv::Mat roi = p.padded(cv::Rect(0, 0, in.cols, in.rows));
+    in.convertTo(roi, m_kernel.depth());
+
+    cv::dft(p.padded, p.spectrum, 0, in.rows);
+    cv::mulSpectrums(p.spectrum, p.kernelSpectrum, p.product, 0);
+    // only the rows up to the bottom of the cropped output are needed from the inverse transform
+    cv::dft(p.product, p.result, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, m_anchor.y + in.rows);
+
+    p.result(cv::Rect(m_anchor.x, m_anchor.y, in.cols, in.rows)).copyTo(out);
+}
+
+void DftConvolver::applyTiled(const cv::Mat& in, cv::Mat& out)
+{
+    int depth = m_kernel.depth();
+    if ( m_tileDftSize.area() == 0 ) {
+        // a tile must at least hold the kernel halo plus as many output pixels
+        m_tileDftSize = cv::Size( cv::getOptimalDFTSize(std::max(m_tileSize, 2*m_kernel.cols-1)),
+                                  cv::getOptimalDFTSize(std::max(m_tileSize, 2*m_kernel.rows-1)) );
+        cv::Mat paddedKernel = cv::Mat::zeros(m_tileDftSize, depth);
+        m_kernel.copyTo( paddedKernel(cv::Rect(0, 0, m_kernel.cols, m_kernel.rows)) );
+        cv::dft(paddedKernel, m_tileKernelSpectrum, 0, m_kernel.rows);
+    }
+
+    // output part of a tile, the rest of the DFT is the halo of overlap-save
+    cv::Size tileSize(m_tileDftSize.width - m_kernel.cols + 1, m_tileDftSize.height - m_kernel.rows + 1);
+    int tilesX = (in.cols + tileSize.width - 1)/tileSize.width;
+    int tilesY = (in.rows + tileSize.height - 1)/tileSize.height;
+
+    out.create(in.size(), depth);
+    cv::parallel_for_(cv::Range(0, tilesX*tilesY), TileBody(*this, in, out, tileSize, tilesX));
+}
+
+std::shared_ptr<DftConvolver::TileScratch> DftConvolver::acquireScratch()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_scratchMutex);
+        if ( ! m_freeScratch.empty() ) {
+            std::shared_ptr<TileScratch> scratch = m_freeScratch.back();
+            m_freeScratch.pop_back();
+            return scratch;
+        }
+    }
+    int depth = m_kernel.depth();
+    std::shared_ptr<TileScratch> scratch(new TileScratch);
+    scratch->padded.create(m_tileDftSize, depth);
+    scratch->spectrum.create(m_tileDftSize, depth);
+    scratch->product.create(m_tileDftSize, depth);
+    scratch->result.create(m_tileDftSize, depth);
+    return scratch;
+}
+
+void DftConvolver::releaseScratch(const std::shared_ptr<TileScratch>& scratch)
+{
+    std::lock_guard<std::mutex> locker(m_scratchMutex);
+    m_freeScratch.push_back(scratch);
+}
+
+void DftConvolver::convolveTile(const cv::Mat& in, cv::Mat& out, const cv::Rect& tile, TileScratch& s) const
+{
+    // Input window of the tile: the tile grown by the kernel extent, before and after the anchor.
+    // The circular convolution is exact from (kernel.cols-1, kernel.rows-1) on, which is the tile.
+    cv::Rect window(tile.x - (m_kernel.cols-1-m_anchor.x), tile.y - (m_kernel.rows-1-m_anchor.y),
+                    tile.width + m_kernel.cols - 1, tile.height + m_kernel.rows - 1);
+    cv::Rect inside = window & cv::Rect(0, 0, in.cols, in.rows);
+
+    if ( inside != window || window.width < s.padded.cols || window.height < s.padded.rows ) {
+        s.padded.setTo(cv::Scalar::all(0));
+    }
+    cv::Mat roi = s.padded(cv::Rect(inside.x - window.x, inside.y - window.y, inside.width, inside.height));
+    in(inside).convertTo(roi, m_kernel.depth());
+
+    cv::dft(s.padded, s.spectrum, 0, window.height);
+    cv::mulSpectrums(s.spectrum, m_tileKernelSpectrum, s.product, 0);
+    cv::dft(s.product, s.result, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, window.height);
+
+    cv::Mat dst = out(tile);
+    s.result(cv::Rect(m_kernel.cols-1, m_kernel.rows-1, tile.width, tile.height)).copyTo(dst);
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
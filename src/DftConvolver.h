@@ -0,0 +1,205 @@
+#ifndef DFTCONVOLVER_H
+#define DFTCONVOLVER_H
+
+/** ***********************************************************************************************
+ * @file DftConvolver.h
+ * @brief Convolution engine which caches the kernel spectrum and the DFT scratch buffers
+ *        so that filtering a stream of equally sized frames does not allocate.
+ */
+
+// CV
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+
+namespace oscv
+{
+    /**
+     * @brief The DftConvolver class Linear 2D convolution of single channel images with a fixed kernel.
+     *
+     *        The output has the same size as the input ("same" convolution), the kernel origin is at
+     *        (kernel.cols/2, kernel.rows/2) and pixels outside of the image are treated as zero.
+     *        The first call for a given image size builds a plan: the optimal DFT size, the padded
+     *        kernel spectrum and the scratch buffers. Later calls with the same image size cost one
+     *        forward and one inverse DFT. Small kernels are convolved directly in the spatial domain.
+     *        Very large images are convolved tile by tile (overlap-save) in parallel, so the scratch
+     *        memory is bounded by the tile size and the number of threads, not by the image size.
+     *
+     *        The object is not thread safe, use one convolver per thread.
+     */
+    class DftConvolver
+    {
+    public:
+        /**
+         * @brief The Method enum Auto selects Direct for kernels up to DIRECT_KERNEL_AREA pixels,
+         *        Tiled for images larger than TILED_MIN_AREA pixels and Dft otherwise.
+         */
+        enum class Method { Auto=0, Direct, Dft, Tiled };
+
+        /**
+         * @brief DIRECT_KERNEL_AREA Largest kernel area (11x11) convolved directly with Method::Auto.
+         */
+        static const int DIRECT_KERNEL_AREA = 121;
+
+        /**
+         * @brief MAX_PLANS Number of image sizes kept in the plan cache.
+         */
+        static const int MAX_PLANS = 4;
+
+        /**
+         * @brief TILED_MIN_AREA Smallest image area (2048x2048) convolved in tiles with Method::Auto.
+         */
+        static const int TILED_MIN_AREA = 2048*2048;
+
+        /**
+         * @brief DEFAULT_TILE_SIZE Default DFT size of a tile. A 512x512 float tile is 1MB per buffer.
+         */
+        static const int DEFAULT_TILE_SIZE = 512;
+
+        DftConvolver();
+
+        /**
+         * @brief DftConvolver
+         * @param kernel single channel kernel. CV_64F kernels make the convolver work in double,
+         *        any other depth is converted to CV_32F.
+         * @param method @see Method
+         */
+        explicit DftConvolver(const cv::Mat& kernel, Method method=Method::Auto);
+
+        /**
+         * @brief setKernel set a new kernel and drop all cached plans.
+         * @param kernel single channel, non-empty kernel
+         * @return false if the kernel is empty or has more than one channel.
+         */
+        bool setKernel(const cv::Mat& kernel);
+
+        /**
+         * @brief apply convolve the image with the kernel.
+         * @param in single channel image of any depth
+         * @param out output in the working depth of the convolver (CV_32F or CV_64F). The buffer
+         *        is reused if it already has the right size and type. Must not share data with in.
+         * @return false if there is no kernel or the input is empty or not single channel.
+         */
+        bool apply(const cv::Mat& in, cv::Mat& out);
+
+        /**
+         * @brief clear drop all cached plans and scratch buffers but keep the kernel.
+         */
+        void clear();
+
+        /**
+         * @brief resolveMethod path taken by apply() for the current kernel and the given image size.
+         * @param imgSize size of the image to be convolved
+         * @return Direct, Dft or Tiled, never Auto
+         */
+        Method resolveMethod(const cv::Size& imgSize) const;
+
+        /**
+         * @brief setTileSize set the DFT size of a tile in Tiled mode. It is enlarged if the kernel
+         *        does not fit, the output part of a tile is tileSize - kernel size + 1 pixels wide.
+         * @param tileSize DFT size of a tile, e.g. DEFAULT_TILE_SIZE
+         */
+        void setTileSize(int tileSize);
+
+        inline int tileSize() const;
+
+        inline const cv::Mat& kernel() const;
+
+        inline int depth() const;
+
+        inline Method method() const;
+
+        inline void setMethod(Method method);
+
+
+    private:
+        /**
+         * @brief The Plan struct cached DFT state for one image size
+         */
+        struct Plan
+        {
+            cv::Size imgSize;
+            cv::Size dftSize;
+            cv::Mat kernelSpectrum;
+            cv::Mat padded;   // zero padded image, only the image ROI is overwritten
+            cv::Mat spectrum;
+            cv::Mat product;
+            cv::Mat result;
+        };
+
+        Plan& plan(const cv::Size& imgSize);
+
+        void applyDirect(const cv::Mat& in, cv::Mat& out);
+
+        void applyDft(const cv::Mat& in, cv::Mat& out);
+
+        void applyTiled(const cv::Mat& in, cv::Mat& out);
+
+        /**
+         * @brief The TileScratch struct DFT buffers of one worker in Tiled mode
+         */
+        struct TileScratch
+        {
+            cv::Mat padded;
+            cv::Mat spectrum;
+            cv::Mat product;
+            cv::Mat result;
+        };
+
+        std::shared_ptr<TileScratch> acquireScratch();
+
+        void releaseScratch(const std::shared_ptr<TileScratch>& scratch);
+
+        void convolveTile(const cv::Mat& in, cv::Mat& out, const cv::Rect& tile, TileScratch& s) const;
+
+        class TileBody;
+
+
+        cv::Mat m_kernel;   // kernel in working depth
+        cv::Mat m_flipped;  // kernel flipped around both axes for cv::filter2D
+        cv::Point m_anchor; // kernel origin
+        Method m_method;
+        std::vector<Plan> m_plans; // most recently used first
+
+        int m_tileSize;
+        cv::Size m_tileDftSize;       // empty until the first tiled convolution
+        cv::Mat m_tileKernelSpectrum; // kernel spectrum in tile DFT size
+        std::vector< std::shared_ptr<TileScratch> > m_freeScratch;
+        std::mutex m_scratchMutex;
+    };
+
+    ///////////////////////////////////////INLINE
+
+    const cv::Mat& DftConvolver::kernel() const
+    {
+        return m_kernel;
+    }
+
+    int DftConvolver::depth() const
+    {
+        return m_kernel.empty()? CV_32F : m_kernel.depth();
+    }
+
+    int DftConvolver::tileSize() const
+    {
+        return m_tileSize;
+    }
+
+    DftConvolver::Method DftConvolver::method() const
+    {
+        return m_method;
+    }
+
+    void DftConvolver::setMethod(Method method)
+    {
+        m_method = method;
+    }
+
+} // end namespace
+
+#endif // DFTCONVOLVER_H
+/////////////////////////////////////////////END OF FILE //////////////////////////////////////////////////
@@ -0,0 +1,66 @@
+#include "Drawing.h"
+
+using namespace oscv;
+
+
+Contours::Contours( const cv::Mat& binaryImg, int minArea )
+{
+    find(binaryImg, minArea);
+}
+
+Contours::Contours()
+{
+}
+
+void Contours::find( const cv::Mat& binaryImg, int minArea, double scale )
+{
+    m_contours.clear();
+    m_rects.clear();
+    m_hierarchies.clear();
+    m_moments.clear();
+    if ( binaryImg.empty() ) {
+        return;
+    }
+
+    // findContours writes into its input (OpenCV 2), the copy reuses m_work frame after frame
+    binaryImg.copyTo(m_work);
+    cv::findContours(m_work, m_found, m_foundHierarchies, CV_RETR_CCOMP, CV_CHAIN_APPROX_SIMPLE);
+
+    // filter by area, m_index maps the found contours to the kept ones for the hierarchy
+    // minArea is in scaled pixels, the area of the unscaled contour is compared so dropped ones are not scaled
+    const double scaledMinArea = minArea / (scale * scale);
+    m_index.assign(m_found.size(), -1);
+    for ( size_t i=0; i<m_found.size(); ++i )
+    {
+        Contour_t& contour = m_found[i];
+        if ( cv::contourArea(contour) < scaledMinArea ) {
+            continue;
+        }
+        if ( scale != 1.0 ) {
+            for ( size_t k=0; k<contour.size(); ++k ) {
+                contour[k].x = cvRound(contour[k].x * scale);
+                contour[k].y = cvRound(contour[k].y * scale);
+            }
+        }
+        cv::Moments m = cv::moments(contour);
+        m_index[i] = static_cast<int>(m_contours.size());
+        m_contours.push_back(Contour_t());
+        m_contours.back().swap(contour);
+        m_rects.push_back( cv::boundingRect(m_contours.back()) );
+        m_moments.push_back(m);
+    }
+
+    for ( size_t i=0; i<m_found.size(); ++i )
+    {
+        if ( m_index[i] < 0 ) {
+            continue;
+        }
+        Hierarchy_t h = m_foundHierarchies[i];
+        for ( int k=0; k<4; ++k ) {
+            h[k] = h[k] >= 0 ? m_index[h[k]] : -1; // links to dropped contours are cut
+        }
+        m_hierarchies.push_back(h);
+    }
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
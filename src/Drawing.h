@@ -34,6 +34,18 @@ public:
      */
     Contours( const cv::Mat& binaryImg, int minArea=10 );
 
+    //! Empty, call find() frame after frame to reuse the buffers
+    Contours();
+
+    /**
+     * @brief find the outer contours and their holes in a binary image, replaces the previous result
+     * @param binaryImg CV_8UC1 mask, e.g. from MotionDetector. It is not modified.
+     * @param minArea min area of a contour to be kept, in pixels of the scaled coordinates (the frame
+     *        pixels for a mask of half the frame size and scale 2)
+     * @param scale factor for the coordinates, e.g. 2 for a mask of half the frame size
+     */
+    void find( const cv::Mat& binaryImg, int minArea=10, double scale=1.0 );
+
     inline const std::vector<Contour_t>& contours() const;
 
     inline const std::vector<Rect_t>& rectangles() const;
@@ -55,6 +67,12 @@ private:
     std::vector<Hierarchy_t> m_hierarchies;
     std::vector<cv::Moments>  m_moments;
 
+    //! All contours before the area filter and the copy of the image which findContours modifies
+    std::vector<Contour_t> m_found;
+    std::vector<Hierarchy_t> m_foundHierarchies;
+    std::vector<int> m_index;
+    cv::Mat m_work;
+
 };
 ////////////////////INLINE
 
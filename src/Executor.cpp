@@ -0,0 +1,231 @@
+#include "Executor.h"
+
+// oscv
+#include "Tracer.h"
+
+#include <algorithm>
+
+#if defined (__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace oscv;
+
+
+namespace
+{
+    // worker identity of the calling thread, checked against the executor it belongs to
+    thread_local const Executor* t_executor = nullptr;
+    thread_local int t_worker = -1;
+}
+
+
+Executor::Executor(int threads)
+    : m_pending(0)
+    , m_nextQueue(0)
+    , m_stolen(0)
+    , m_executed(0)
+    , m_stop(false)
+{
+    if ( threads <= 0 ) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for ( int i=0; i<threads; ++i ) {
+        m_workers.push_back( std::unique_ptr<Worker>(new Worker) );
+    }
+    // all queues exist before the first worker can steal
+    for ( int i=0; i<threads; ++i ) {
+        m_workers[i]->thread = std::thread(&Executor::workerLoop, this, i);
+    }
+}
+
+Executor::~Executor()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for ( size_t i=0; i<m_workers.size(); ++i ) {
+        m_workers[i]->thread.join();
+    }
+}
+
+Executor& Executor::instance()
+{
+    static Executor executor;
+    return executor;
+}
+
+void Executor::submit(Task task, Priority priority)
+{
+    int queue = t_executor == this ? t_worker
+                                   : static_cast<int>(m_nextQueue++ % m_workers.size());
+    m_pending++; // before the push, a worker must not sleep or exit while a task is queued
+    {
+        Worker& worker = *m_workers[queue];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<int>(priority)].push_back( std::move(task) );
+    }
+    {
+        // a worker checks m_pending under this mutex before it sleeps, no wake up is lost
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+bool Executor::runOne()
+{
+    Task task;
+    if ( ! pop(t_executor == this ? t_worker : -1, task) ) {
+        return false;
+    }
+    run(task);
+    return true;
+}
+
+bool Executor::isWorkerThread() const
+{
+    return t_executor == this;
+}
+
+bool Executor::setAffinity(bool enable)
+{
+#if defined (__linux__)
+    int cpus = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    bool ok = true;
+    for ( size_t i=0; i<m_workers.size(); ++i )
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if ( enable ) {
+            CPU_SET(static_cast<int>(i) % cpus, &set);
+        }
+        else {
+            for ( int c=0; c<cpus; ++c ) {
+                CPU_SET(c, &set);
+            }
+        }
+        ok = pthread_setaffinity_np(m_workers[i]->thread.native_handle(), sizeof(set), &set) == 0 && ok;
+    }
+    return ok;
+#else
+    (void)enable;
+    return false;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Executor::workerLoop(int index)
+{
+    t_executor = this;
+    t_worker = index;
+    VIDEN_TRACE_THREAD_NAME("Executor");
+    Task task;
+    while ( true )
+    {
+        if ( pop(index, task) ) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]{ return m_stop || m_pending > 0; });
+        if ( m_stop && m_pending == 0 ) {
+            return;
+        }
+    }
+}
+
+bool Executor::pop(int self, Task& task)
+{
+    const int count = static_cast<int>(m_workers.size());
+    for ( int p=0; p<PRIORITY_COUNT; ++p )
+    {
+        if ( self >= 0 )
+        {
+            Worker& own = *m_workers[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if ( ! own.queues[p].empty() ) {
+                task = std::move(own.queues[p].back());
+                own.queues[p].pop_back();
+                m_pending--;
+                return true;
+            }
+        }
+        for ( int k=1; k<=count; ++k )
+        {
+            int victim = (std::max(self, 0) + k) % count;
+            if ( victim == self ) {
+                continue;
+            }
+            Worker& other = *m_workers[victim];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if ( ! other.queues[p].empty() ) {
+                task = std::move(other.queues[p].front());
+                other.queues[p].pop_front();
+                m_pending--;
+                if ( self >= 0 ) {
+                    m_stolen++;
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Executor::run(Task& task)
+{
+    m_executed++;
+    task();
+    task = nullptr; // release the captures before the worker sleeps
+}
+
+
+TaskGroup::TaskGroup(Executor& executor, Executor::Priority priority)
+    : m_executor(executor)
+    , m_priority(priority)
+    , m_state(std::make_shared<State>())
+{
+    m_state->pending = 0;
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void TaskGroup::run(Executor::Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->pending++;
+    }
+    std::shared_ptr<State> state = m_state;
+    m_executor.submit([state, task]()
+    {
+        task();
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->pending--;
+        state->done.notify_all();
+    }, m_priority);
+}
+
+void TaskGroup::wait(int maxPending)
+{
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    State* state = m_state.get();
+    m_executor.waitUntil(lock, state->done, [state, maxPending]{ return state->pending <= maxPending; });
+}
+
+int TaskGroup::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->pending;
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
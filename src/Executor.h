@@ -0,0 +1,217 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+/** ***********************************************************************************************
+ * @file Executor.h
+ * @brief Library wide work-stealing thread pool for decode, read ahead, encode and processing tasks.
+ */
+
+// Qt
+#include <QtGlobal>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The Executor class runs short tasks on a fixed set of worker threads, one per core by default.
+ *
+ *        Every worker has its own queues. A task submitted from a worker goes to the queue of that
+ *        worker and runs from there last in, first out, which keeps the data of a stream in the cache
+ *        of its core. Idle workers steal the oldest tasks of the others. Tasks of a higher priority
+ *        class run before any task of a lower class, so e.g. the playback streams are not starved
+ *        by a batch extraction.
+ *
+ *        Tasks must not block for long, e.g. on another task. Waiting inside a task is done with
+ *        waitUntil() or TaskGroup::wait(), which run other tasks meanwhile.
+ */
+class Executor
+{
+public:
+    enum class Priority { High=0, Normal, Low };
+
+    static const int PRIORITY_COUNT = 3;
+
+    typedef std::function<void()> Task;
+
+    /**
+     * @brief Executor
+     * @param threads number of workers, 0 for std::thread::hardware_concurrency()
+     */
+    explicit Executor(int threads=0);
+
+    //! Runs the queued tasks and joins the workers
+    ~Executor();
+
+    //! The executor shared by the library, created on first use
+    static Executor& instance();
+
+    /**
+     * @brief submit queue a task
+     * @param task
+     * @param priority class of the task
+     */
+    void submit(Task task, Priority priority=Priority::Normal);
+
+    /**
+     * @brief runOne run one queued task on the calling thread
+     * @return false if there was none
+     */
+    bool runOne();
+
+    /**
+     * @brief waitUntil wait on a condition variable until pred() is true. On a worker thread of this
+     *        executor queued tasks are run meanwhile, so that waiting tasks cannot deadlock the pool.
+     * @param lock locked mutex of the condition variable
+     * @param cond notified when pred() may have changed
+     * @param pred
+     */
+    template<typename Pred>
+    void waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cond, Pred pred);
+
+    //! True if the calling thread is a worker of this executor
+    bool isWorkerThread() const;
+
+    inline int threadCount() const;
+
+    /**
+     * @brief setAffinity pin worker i to cpu i modulo the number of cpus (Linux only)
+     * @param enable false allows all cpus again
+     * @return false if not supported or denied
+     */
+    bool setAffinity(bool enable);
+
+    //! Number of tasks run by a worker which did not queue them
+    inline quint64 stolenTasks() const;
+
+    inline quint64 executedTasks() const;
+
+private:
+    struct Worker
+    {
+        std::deque<Task> queues[PRIORITY_COUNT];
+        std::mutex mutex;
+        std::thread thread;
+    };
+
+    Executor(const Executor&);
+    Executor& operator=(const Executor&);
+
+    void workerLoop(int index);
+
+    //! Own queue from the back, then the other queues from the front, highest priority first
+    bool pop(int self, Task& task);
+
+    void run(Task& task);
+
+    std::vector< std::unique_ptr<Worker> > m_workers;
+    std::atomic<int> m_pending;            // queued, not started
+    std::atomic<unsigned> m_nextQueue;     // round robin for submissions from outside
+    std::atomic<quint64> m_stolen;
+    std::atomic<quint64> m_executed;
+    bool m_stop;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+};
+
+
+/**
+ * @brief The TaskGroup class tasks which are waited for together, e.g. the frames of one extraction.
+ *        The destructor waits for the tasks of the group.
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(Executor& executor=Executor::instance(), Executor::Priority priority=Executor::Priority::Normal);
+
+    ~TaskGroup();
+
+    void run(Executor::Task task);
+
+    /**
+     * @brief wait until at most maxPending tasks of the group have not finished
+     * @param maxPending 0 waits for all, larger values bound the tasks in flight
+     */
+    void wait(int maxPending=0);
+
+    int pending() const;
+
+    inline void setPriority(Executor::Priority priority);
+
+    inline Executor::Priority priority() const;
+
+private:
+    struct State
+    {
+        int pending;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    TaskGroup(const TaskGroup&);
+    TaskGroup& operator=(const TaskGroup&);
+
+    Executor& m_executor;
+    Executor::Priority m_priority;
+    std::shared_ptr<State> m_state;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+template<typename Pred>
+void Executor::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cond, Pred pred)
+{
+    if ( ! isWorkerThread() ) {
+        cond.wait(lock, pred);
+        return;
+    }
+    while ( ! pred() )
+    {
+        lock.unlock();
+        bool ran = runOne();
+        lock.lock();
+        if ( ! ran && ! pred() ) {
+            // nothing to help with, the task we wait for runs on another worker
+            cond.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+}
+
+int Executor::threadCount() const
+{
+    return static_cast<int>(m_workers.size());
+}
+
+quint64 Executor::stolenTasks() const
+{
+    return m_stolen;
+}
+
+quint64 Executor::executedTasks() const
+{
+    return m_executed;
+}
+
+
+void TaskGroup::setPriority(Executor::Priority priority)
+{
+    m_priority = priority;
+}
+
+Executor::Priority TaskGroup::priority() const
+{
+    return m_priority;
+}
+
+}
+#endif // EXECUTOR_H
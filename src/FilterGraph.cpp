@@ -0,0 +1,210 @@
+#include "FilterGraph.h"
+
+// oscv
+#include "PlayerMetrics.h"
+#include "Tracer.h"
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+FilterGraph::FilterGraph()
+    : m_parallel(true)
+    , m_allocations(0)
+{
+    m_plannedShape.type = -1;
+}
+
+FilterGraph::~FilterGraph()
+{
+}
+
+int FilterGraph::add(const QString& name, const std::vector<int>& inputs, const Op& op, const ShapeFunc& shape)
+{
+    std::unique_ptr<Node> node(new Node);
+    node->name = name;
+    node->inputs = inputs;
+    node->op = op;
+    node->shape = shape;
+    node->level = 0;
+    for ( size_t i=0; i<inputs.size(); ++i )
+    {
+        int in = inputs[i];
+        if ( in < INPUT || in > nodeCount() ) {
+            return -1;
+        }
+        node->args.push_back( in == INPUT ? &m_input : &m_nodes[in-1]->output );
+        if ( in != INPUT ) {
+            node->level = std::max(node->level, m_nodes[in-1]->level + 1);
+        }
+    }
+    node->count = 0;
+    node->totalNs = 0;
+    node->maxNs = 0;
+    node->lastNs = 0;
+
+    if ( node->level >= static_cast<int>(m_levels.size()) ) {
+        m_levels.resize(node->level + 1);
+    }
+    m_levels[node->level].push_back(node.get());
+    m_nodes.push_back( std::move(node) );
+    m_plannedShape.type = -1; // plan again with the new node
+    return nodeCount();
+}
+
+int FilterGraph::add(const QString& name, int input, const UnaryOp& op, const ShapeFunc& shape)
+{
+    return add(name, std::vector<int>(1, input),
+               [op](const std::vector<const cv::Mat*>& inputs, cv::Mat& output) { op(*inputs[0], output); },
+               shape);
+}
+
+bool FilterGraph::process(const cv::Mat& input)
+{
+    if ( m_nodes.empty() || input.empty() ) {
+        return false;
+    }
+    m_input = input;
+    if ( input.size() != m_plannedShape.size || input.type() != m_plannedShape.type ) {
+        plan(input);
+    }
+
+    for ( size_t l=0; l<m_levels.size(); ++l )
+    {
+        std::vector<Node*>& level = m_levels[l];
+        if ( ! m_parallel || level.size() == 1 ) {
+            for ( size_t i=0; i<level.size(); ++i ) {
+                run(*level[i]);
+            }
+            continue;
+        }
+        // the nodes of a level only read outputs of lower levels, the calling thread takes the last one
+        TaskGroup group;
+        for ( size_t i=0; i+1<level.size(); ++i ) {
+            Node* node = level[i];
+            group.run([this, node]{ run(*node); });
+        }
+        run(*level.back());
+        group.wait();
+    }
+    return true;
+}
+
+const cv::Mat& FilterGraph::output(int node) const
+{
+    static const cv::Mat empty;
+    if ( node == INPUT ) {
+        return m_input;
+    }
+    return node > INPUT && node <= nodeCount() ? m_nodes[node-1]->output : empty;
+}
+
+std::vector<FilterGraph::NodeStats> FilterGraph::stats() const
+{
+    std::vector<NodeStats> result;
+    for ( size_t i=0; i<m_nodes.size(); ++i )
+    {
+        const Node& node = *m_nodes[i];
+        NodeStats s;
+        s.name = node.name;
+        s.count = node.count;
+        s.totalNs = node.totalNs;
+        s.maxNs = node.maxNs;
+        s.lastNs = node.lastNs;
+        result.push_back(s);
+    }
+    return result;
+}
+
+void FilterGraph::resetStats()
+{
+    for ( size_t i=0; i<m_nodes.size(); ++i )
+    {
+        Node& node = *m_nodes[i];
+        node.count = 0;
+        node.totalNs = 0;
+        node.maxNs = 0;
+        node.lastNs = 0;
+    }
+}
+
+FilterGraph::ShapeFunc FilterGraph::same()
+{
+    return [](const std::vector<Shape>& inputs) { return inputs[0]; };
+}
+
+FilterGraph::ShapeFunc FilterGraph::withType(int type)
+{
+    return [type](const std::vector<Shape>& inputs) {
+        Shape shape = inputs[0];
+        shape.type = type;
+        return shape;
+    };
+}
+
+FilterGraph::ShapeFunc FilterGraph::fixed(const cv::Size& size, int type)
+{
+    return [size, type](const std::vector<Shape>&) {
+        Shape shape;
+        shape.size = size;
+        shape.type = type;
+        return shape;
+    };
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FilterGraph::plan(const cv::Mat& input)
+{
+    m_plannedShape.size = input.size();
+    m_plannedShape.type = input.type();
+
+    // the nodes are stored in an order where all inputs come first
+    std::vector<Shape> shapes(1, m_plannedShape);
+    std::vector<Shape> inputs;
+    for ( size_t i=0; i<m_nodes.size(); ++i )
+    {
+        Node& node = *m_nodes[i];
+        Shape shape;
+        shape.type = -1;
+        inputs.clear();
+        bool known = true;
+        for ( size_t k=0; k<node.inputs.size(); ++k ) {
+            inputs.push_back(shapes[node.inputs[k]]);
+            known = known && inputs.back().type >= 0;
+        }
+        if ( node.shape && known )
+        {
+            shape = node.shape(inputs);
+            uchar* before = node.output.data;
+            node.output.create(shape.size, shape.type);
+            if ( node.output.data != before ) {
+                m_allocations++;
+            }
+        }
+        shapes.push_back(shape);
+    }
+}
+
+void FilterGraph::run(Node& node)
+{
+    VIDEN_TRACE_SCOPE("filter_node");
+    quint64 start = PlayerMetrics::now();
+    uchar* before = node.output.data;
+    node.op(node.args, node.output);
+    if ( node.output.data != before ) {
+        m_allocations++; // the declared shape was wrong or missing, the new buffer is kept
+    }
+    quint64 ns = PlayerMetrics::now() - start;
+    node.count++;
+    node.totalNs += ns;
+    node.lastNs = ns;
+    quint64 max = node.maxNs;
+    while ( ns > max && ! node.maxNs.compare_exchange_weak(max, ns) ) {
+    }
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,190 @@
+#ifndef FILTERGRAPH_H
+#define FILTERGRAPH_H
+
+/** ***********************************************************************************************
+ * @file FilterGraph.h
+ * @brief A small DAG of per frame image operations with buffers reused from frame to frame.
+ */
+
+// Qt
+#include <QString>
+
+// oscv
+#include "Executor.h"
+
+// cv
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The FilterGraph class runs a chain or tree of OpenCV operations on every frame.
+ *
+ *        Each node reads the outputs of earlier nodes (or the input frame, INPUT) and writes into its
+ *        own output buffer. A node declares the shape (size and type) of its output as a function of
+ *        the shapes of its inputs, so all buffers are allocated once when the first frame or a frame of
+ *        another shape arrives. OpenCV functions which create() their output with that shape then
+ *        write into the existing buffer, a frame of the same shape does not allocate.
+ *
+ *        Nodes whose inputs are all computed run in parallel on the Executor, e.g. two branches from
+ *        the same grey image. stats() has the time per node.
+ *
+ *        @code
+ *        FilterGraph graph;
+ *        int gray = graph.add("gray", FilterGraph::INPUT,
+ *                             [](const cv::Mat& in, cv::Mat& out){ cv::cvtColor(in, out, CV_BGR2GRAY); },
+ *                             FilterGraph::withType(CV_8UC1));
+ *        int mask = graph.add("threshold", gray,
+ *                             [](const cv::Mat& in, cv::Mat& out){ cv::threshold(in, out, 128, 255, CV_THRESH_BINARY); });
+ *        graph.process(frame);
+ *        Contours contours(graph.output(mask));
+ *        @endcode
+ *
+ *        The outputs are overwritten by the next process(), clone them to keep them. A graph processes
+ *        one frame at a time, e.g. a ProcessingStage filter needs a graph per concurrent frame.
+ */
+class FilterGraph
+{
+public:
+    //! Id of the input frame of process()
+    static const int INPUT = 0;
+
+    struct Shape
+    {
+        cv::Size size;
+        int type;
+    };
+
+    //! Output shape from the shapes of the inputs of the node
+    typedef std::function<Shape(const std::vector<Shape>& inputs)> ShapeFunc;
+
+    //! Operation with any number of inputs, writes output
+    typedef std::function<void(const std::vector<const cv::Mat*>& inputs, cv::Mat& output)> Op;
+
+    //! Operation with one input
+    typedef std::function<void(const cv::Mat& input, cv::Mat& output)> UnaryOp;
+
+    struct NodeStats
+    {
+        QString name;
+        quint64 count;
+        quint64 totalNs;
+        quint64 maxNs;
+        quint64 lastNs;
+
+        inline double meanNs() const;
+    };
+
+    FilterGraph();
+
+    ~FilterGraph();
+
+    /**
+     * @brief add a node, the graph is built before the first process()
+     * @param name for stats()
+     * @param inputs ids of earlier nodes or INPUT
+     * @param op
+     * @param shape output shape, null if unknown: the op allocates on the first frame, the buffer is
+     *        reused afterwards as long as the op keeps the shape
+     * @return id of the node, -1 if an input does not exist
+     */
+    int add(const QString& name, const std::vector<int>& inputs, const Op& op, const ShapeFunc& shape=ShapeFunc());
+
+    //! Node with one input, the output has the shape of the input by default
+    int add(const QString& name, int input, const UnaryOp& op, const ShapeFunc& shape=same());
+
+    /**
+     * @brief process run all nodes on the frame
+     * @param input
+     * @return false if the graph is empty or the input is empty
+     */
+    bool process(const cv::Mat& input);
+
+    /**
+     * @brief output of a node after process()
+     * @param node id from add(), INPUT for the input frame
+     */
+    const cv::Mat& output(int node) const;
+
+    inline int nodeCount() const;
+
+    //! Run independent nodes in parallel on the Executor, default true
+    inline void setParallel(bool enable);
+
+    std::vector<NodeStats> stats() const;
+
+    void resetStats();
+
+    //! Number of output buffers allocated so far, constant while the input shape does not change
+    inline int allocations() const;
+
+    static ShapeFunc same();
+
+    //! Size of the first input and the given type, e.g. CV_8UC1 after a colour conversion
+    static ShapeFunc withType(int type);
+
+    static ShapeFunc fixed(const cv::Size& size, int type);
+
+private:
+    struct Node
+    {
+        QString name;
+        std::vector<int> inputs;
+        std::vector<const cv::Mat*> args;   // the outputs of the inputs, set up once
+        Op op;
+        ShapeFunc shape;
+        int level;                          // longest path from the input
+        cv::Mat output;
+        std::atomic<quint64> count;
+        std::atomic<quint64> totalNs;
+        std::atomic<quint64> maxNs;
+        std::atomic<quint64> lastNs;
+    };
+
+    FilterGraph(const FilterGraph&);
+    FilterGraph& operator=(const FilterGraph&);
+
+    //! Allocate the outputs for the shape of the input
+    void plan(const cv::Mat& input);
+
+    void run(Node& node);
+
+    std::vector< std::unique_ptr<Node> > m_nodes;    // index = id-1
+    std::vector< std::vector<Node*> > m_levels;       // nodes of a level only read lower levels
+    cv::Mat m_input;
+    Shape m_plannedShape;
+    bool m_parallel;
+    std::atomic<int> m_allocations;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+double FilterGraph::NodeStats::meanNs() const
+{
+    return count > 0 ? static_cast<double>(totalNs) / count : 0.0;
+}
+
+int FilterGraph::nodeCount() const
+{
+    return static_cast<int>(m_nodes.size());
+}
+
+void FilterGraph::setParallel(bool enable)
+{
+    m_parallel = enable;
+}
+
+int FilterGraph::allocations() const
+{
+    return m_allocations;
+}
+
+}
+#endif // FILTERGRAPH_H
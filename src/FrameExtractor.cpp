@@ -0,0 +1,94 @@
+#include "FrameExtractor.h"
+
+// oscv
+#include "Tracer.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace oscv;
+
+
+FrameExtractor::FrameExtractor()
+    : m_failedFrames(0)
+    , m_truncated(false)
+    , m_gated(false)
+{
+}
+
+bool FrameExtractor::open(const QString& filename)
+{
+    m_decoder = IDecoder::create(filename);
+    return m_decoder != nullptr;
+}
+
+void FrameExtractor::close()
+{
+    m_decoder.reset();
+    m_frame.release();
+}
+
+int FrameExtractor::run(const FrameCallback& callback, int first, int last, int step)
+{
+    m_failedFrames = 0;
+    m_truncated = false;
+    if ( ! m_decoder ) {
+        return -1;
+    }
+    step = std::max(1, step);
+    int count = m_decoder->frameCount();
+    if ( last < 0 || (count > 0 && last >= count) ) {
+        last = count > 0 ? count-1 : std::numeric_limits<int>::max();
+    }
+    if ( m_decoder->position() != first && ! m_decoder->seek(first) ) {
+        return -1;
+    }
+
+    m_changeGate.reset();
+    int delivered = 0;
+    int failures = 0; // in a row
+    for ( int frameNumber = first; frameNumber <= last; frameNumber += step )
+    {
+        bool decoded;
+        {
+            VIDEN_TRACE_SCOPE("decode");
+            decoded = m_decoder->read(m_frame);
+        }
+        if ( ! decoded )
+        {
+            if ( count <= 0 ) {
+                break; // the end of a source of unknown length
+            }
+            // a damaged frame, seek behind it
+            ++m_failedFrames;
+            if ( frameNumber + step > last ) {
+                break;
+            }
+            if ( ++failures >= MAX_READ_FAILURES || ! m_decoder->seek(frameNumber + step) ) {
+                m_truncated = true;
+                break;
+            }
+            continue;
+        }
+        failures = 0;
+        if ( ! m_gated || m_changeGate.accept(m_frame) )
+        {
+            ++delivered;
+            if ( ! callback(m_frame, frameNumber) ) {
+                break;
+            }
+        }
+        // skip to the next wanted frame, sequential grabbing is cheaper than seeking for small steps
+        bool ok = true;
+        for ( int i=1; i<step && ok; ++i ) {
+            ok = m_decoder->grab();
+        }
+        if ( ! ok && (count <= 0 || frameNumber + step > last || ! m_decoder->seek(frameNumber + step)) ) {
+            m_truncated = count > 0 && frameNumber + step <= last;
+            break;
+        }
+    }
+    return delivered;
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,134 @@
+#ifndef FRAMEEXTRACTOR_H
+#define FRAMEEXTRACTOR_H
+
+/** ***********************************************************************************************
+ * @file FrameExtractor.h
+ * @brief Headless frame delivery from videos and image sequences to a callback, for batch jobs.
+ */
+
+// oscv
+#include "Decoder.h"
+#include "ChangeGate.h"
+
+#include <functional>
+#include <memory>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The FrameExtractor class decodes a range of frames on the calling thread and hands each
+ *        one to a callback. There are no threads, signals or event loop involved, so many
+ *        extractors can run side by side in worker threads of a batch process.
+ *
+ *        For pull based access use decoder() directly.
+ */
+class FrameExtractor
+{
+public:
+    /**
+     * @brief FrameCallback
+     * @param frame decoded frame, valid until the callback returns. Clone it to keep it.
+     * @param frameNumber position in the video or sequence
+     * @return false to stop the extraction
+     */
+    typedef std::function<bool(const cv::Mat& frame, int frameNumber)> FrameCallback;
+
+    //! run() gives up after this many frames in a row which cannot be decoded
+    static const int MAX_READ_FAILURES = 8;
+
+    FrameExtractor();
+
+    /**
+     * @brief open a video or any image of a sequence, @see IDecoder::create()
+     */
+    bool open(const QString& filename);
+
+    void close();
+
+    inline bool isOpen() const;
+
+    //! The decoder of the opened file, null if not open
+    inline IDecoder* decoder() const;
+
+    /**
+     * @brief run decode the frames first, first+step, ... up to last and call the callback for each
+     * @param callback
+     * @param first frame number to start with
+     * @param last last frame number, -1 up to the end
+     * @param step 1 for every frame. Skipped video frames are grabbed, not decoded.
+     * @return number of frames passed to the callback, -1 if nothing is open or first cannot be reached
+     *
+     *         A frame which cannot be decoded is skipped (@see failedFrames()). If the decoder knows
+     *         its frameCount(), run() stops early only after MAX_READ_FAILURES failures in a row or
+     *         if it cannot seek past a failure, @see wasTruncated(). Otherwise the first failure is
+     *         taken as the end of the source.
+     */
+    int run(const FrameCallback& callback, int first=0, int last=-1, int step=1);
+
+    //! Number of frames of the last run() which could not be decoded and were skipped
+    inline int failedFrames() const;
+
+    //! True if the last run() stopped on decoding errors before last, not if the callback stopped it
+    inline bool wasTruncated() const;
+
+    /**
+     * @brief setChangeGate pass only frames to the callback which differ from the last passed one,
+     *        @see ChangeGate. The first frame of each run() always passes.
+     * @param enable
+     */
+    inline void setChangeGate(bool enable);
+
+    inline bool isChangeGated() const;
+
+    inline ChangeGate& changeGate();
+
+private:
+    std::unique_ptr<IDecoder> m_decoder;
+    cv::Mat m_frame;
+    int m_failedFrames;
+    bool m_truncated;
+    bool m_gated;
+    ChangeGate m_changeGate;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool FrameExtractor::isOpen() const
+{
+    return m_decoder != nullptr;
+}
+
+IDecoder* FrameExtractor::decoder() const
+{
+    return m_decoder.get();
+}
+
+int FrameExtractor::failedFrames() const
+{
+    return m_failedFrames;
+}
+
+bool FrameExtractor::wasTruncated() const
+{
+    return m_truncated;
+}
+
+void FrameExtractor::setChangeGate(bool enable)
+{
+    m_gated = enable;
+}
+
+bool FrameExtractor::isChangeGated() const
+{
+    return m_gated;
+}
+
+ChangeGate& FrameExtractor::changeGate()
+{
+    return m_changeGate;
+}
+
+}
+#endif // FRAMEEXTRACTOR_H
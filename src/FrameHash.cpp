@@ -0,0 +1,94 @@
+#include "FrameHash.h"
+
+// cv
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+FrameHash::FrameHash(Method method)
+    : m_method(method)
+{
+}
+
+quint64 FrameHash::compute(const cv::Mat& frame)
+{
+    if ( frame.empty() ) {
+        return 0;
+    }
+    if ( m_method == Method::Gradient ) {
+        shrink(frame, cv::Size(9, 8));
+        return gradientHash();
+    }
+    shrink(frame, cv::Size(32, 32));
+    return dctHash();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameHash::shrink(const cv::Mat& frame, const cv::Size& size)
+{
+    // shrink first, the colour conversion then touches a few hundred pixels only
+    cv::resize(frame, m_small, size, 0, 0, cv::INTER_AREA);
+    switch ( m_small.channels() )
+    {
+    case 3:
+        cv::cvtColor(m_small, m_gray, CV_BGR2GRAY);
+        break;
+    case 4:
+        cv::cvtColor(m_small, m_gray, CV_BGRA2GRAY);
+        break;
+    default:
+        m_small.copyTo(m_gray);
+        break;
+    }
+}
+
+quint64 FrameHash::dctHash()
+{
+    m_gray.convertTo(m_float, CV_32F);
+    cv::dct(m_float, m_dct);
+
+    // the 8x8 lowest frequencies without the DC row and column, which only carry the mean brightness
+    float coeffs[64];
+    for ( int y=0; y<8; ++y ) {
+        const float* row = m_dct.ptr<float>(y+1);
+        for ( int x=0; x<8; ++x ) {
+            coeffs[y*8 + x] = row[x+1];
+        }
+    }
+    float sorted[64];
+    std::copy(coeffs, coeffs+64, sorted);
+    std::nth_element(sorted, sorted+32, sorted+64);
+    const float median = sorted[32];
+
+    quint64 hash = 0;
+    for ( int i=0; i<64; ++i ) {
+        if ( coeffs[i] > median ) {
+            hash |= Q_UINT64_C(1) << i;
+        }
+    }
+    return hash;
+}
+
+quint64 FrameHash::gradientHash()
+{
+    // float, the frame may have any depth
+    m_gray.convertTo(m_float, CV_32F);
+    quint64 hash = 0;
+    for ( int y=0; y<8; ++y ) {
+        const float* row = m_float.ptr<float>(y);
+        for ( int x=0; x<8; ++x ) {
+            if ( row[x] < row[x+1] ) {
+                hash |= Q_UINT64_C(1) << (y*8 + x);
+            }
+        }
+    }
+    return hash;
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
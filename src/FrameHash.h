@@ -0,0 +1,82 @@
+#ifndef FRAMEHASH_H
+#define FRAMEHASH_H
+
+/** ***********************************************************************************************
+ * @file FrameHash.h
+ * @brief 64 bit perceptual hashes of frames, similar frames differ in few bits.
+ */
+
+// Qt
+#include <QtGlobal>
+
+// oscv
+#include "MathUtils.h"
+
+// cv
+#include <opencv2/core/core.hpp>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The FrameHash class computes perceptual hashes of frames, e.g. to find duplicates.
+ *
+ *        The Hamming distance of two hashes (distance()) measures how different the frames look,
+ *        0..5 of 64 bits is the same picture after re-encoding, scaling or small brightness changes.
+ *        - DCT (pHash): the frame is shrunk to 32x32 grey, each bit tells if one of the 8x8 lowest
+ *          frequencies (without the DC row and column) is above their median. Robust, the default.
+ *        - Gradient (dHash): the frame is shrunk to 9x8 grey, each bit tells if a pixel is darker than
+ *          its right neighbour. Cheaper, less robust against contrast changes.
+ *
+ *        An instance reuses its buffers from frame to frame, it is not thread safe, use one per thread.
+ *        @see HashIndex to store and search the hashes of a clip.
+ */
+class FrameHash
+{
+public:
+    enum class Method { DCT=0, Gradient };
+
+    explicit FrameHash(Method method=Method::DCT);
+
+    /**
+     * @brief compute the hash of a frame
+     * @param frame BGR, BGRA or grey image of any depth
+     * @return hash, 0 for an empty frame
+     */
+    quint64 compute(const cv::Mat& frame);
+
+    inline Method method() const;
+
+    //! Number of differing bits, 0..64
+    static inline int distance(quint64 a, quint64 b);
+
+private:
+    //! Grey frame of the given size into m_gray
+    void shrink(const cv::Mat& frame, const cv::Size& size);
+
+    quint64 dctHash();
+
+    quint64 gradientHash();
+
+    Method m_method;
+    cv::Mat m_small;
+    cv::Mat m_gray;
+    cv::Mat m_float;
+    cv::Mat m_dct;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+FrameHash::Method FrameHash::method() const
+{
+    return m_method;
+}
+
+int FrameHash::distance(quint64 a, quint64 b)
+{
+    return popcount64(a ^ b);
+}
+
+}
+#endif // FRAMEHASH_H
@@ -0,0 +1,280 @@
+#include "FrameSource.h"
+
+// oscv
+#include "Tracer.h"
+#include "OcvUtils.h"
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+struct FrameView::Pool
+{
+    Pool() : allocated(0) {}
+
+    cv::Mat take()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while ( ! free.empty() )
+        {
+            cv::Mat buffer = free.back();
+            free.pop_back();
+            // a copy of the released image may still be read, e.g. by the receiver of a queued
+            // signal: that buffer is left to it and not decoded into
+            if ( ! OcvUtils::isShared(buffer) ) {
+                return buffer;
+            }
+        }
+        allocated++; // the decoder allocates it on the first read
+        return cv::Mat();
+    }
+
+    void recycle(cv::Mat& buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free.push_back(buffer);
+        buffer = cv::Mat();
+    }
+
+    std::mutex mutex;
+    std::vector<cv::Mat> free;
+    int allocated;
+};
+
+
+void FrameView::release()
+{
+    if ( m_pool ) {
+        m_pool->recycle(m_image);
+        m_pool.reset();
+    }
+    m_image = cv::Mat();
+    m_frameNumber = -1;
+}
+
+
+FrameSource::FrameSource()
+    : m_pool(std::make_shared<FrameView::Pool>())
+    , m_prefetch(DEFAULT_PREFETCH)
+    , m_frameCount(0)
+    , m_frameRate(0.0)
+    , m_atEnd(false)
+    , m_stop(true)
+    , m_decoding(false)
+    , m_decoderDone(false)
+{
+}
+
+FrameSource::~FrameSource()
+{
+    close();
+}
+
+bool FrameSource::open(const QString& filename, int prefetch)
+{
+    return open(IDecoder::create(filename), prefetch);
+}
+
+bool FrameSource::open(std::unique_ptr<IDecoder> decoder, int prefetch)
+{
+    close();
+    if ( ! decoder || ! decoder->isOpen() ) {
+        return false;
+    }
+    m_decoder = std::move(decoder);
+    m_frameCount = m_decoder->frameCount();
+    m_frameRate = m_decoder->frameRate();
+    m_prefetch = std::max(0, prefetch);
+    if ( m_prefetch > 0 ) {
+        start();
+    }
+    return true;
+}
+
+void FrameSource::close()
+{
+    stop();
+    for ( Slot& slot : m_ready ) {
+        m_pool->recycle(slot.image);
+    }
+    m_ready.clear();
+    m_decoder.reset();
+    m_frameCount = 0;
+    m_frameRate = 0.0;
+    m_atEnd = false;
+    m_decoderDone = false;
+}
+
+bool FrameSource::next(FrameView& view)
+{
+    view.release();
+    if ( ! m_decoder || m_atEnd ) {
+        return false;
+    }
+    Slot slot;
+    bool prefetched = false;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if ( m_ready.empty() && m_decoding ) {
+            VIDEN_TRACE_SCOPE("prefetch_wait");
+            Executor::instance().waitUntil(lock, m_readyChanged, [this]{ return ! m_ready.empty() || ! m_decoding; });
+        }
+        if ( ! m_ready.empty() ) {
+            slot = m_ready.front();
+            m_ready.pop_front();
+            prefetched = true;
+            schedule();
+        }
+    }
+    if ( ! prefetched ) {
+        // no prefetch, no task is in flight and the decoder is free
+        decode(slot);
+    }
+    lend(slot, view);
+    return view.isValid();
+}
+
+bool FrameSource::tryNext(FrameView& view)
+{
+    view.release();
+    if ( ! m_decoder || m_atEnd ) {
+        return false;
+    }
+    Slot slot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ( m_ready.empty() ) {
+            return false;
+        }
+        slot = m_ready.front();
+        m_ready.pop_front();
+        schedule();
+    }
+    lend(slot, view);
+    return view.isValid();
+}
+
+bool FrameSource::seek(int frameNumber)
+{
+    if ( ! m_decoder ) {
+        return false;
+    }
+    VIDEN_TRACE_SCOPE("seek");
+    stop();
+    for ( Slot& slot : m_ready ) {
+        m_pool->recycle(slot.image);
+    }
+    m_ready.clear();
+    bool ok = m_decoder->seek(frameNumber);
+    m_atEnd = false;
+    m_decoderDone = false;
+    if ( m_prefetch > 0 ) {
+        start();
+    }
+    return ok;
+}
+
+void FrameSource::setPrefetch(int frames)
+{
+    frames = std::max(0, frames);
+    if ( frames == 0 ) {
+        stop();
+        m_prefetch = 0;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_prefetch = frames;
+    if ( m_decoder ) {
+        m_stop = false;
+        schedule();
+    }
+}
+
+void FrameSource::setPriority(Executor::Priority priority)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.setPriority(priority);
+}
+
+int FrameSource::allocatedBuffers() const
+{
+    std::lock_guard<std::mutex> lock(m_pool->mutex);
+    return m_pool->allocated;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameSource::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = false;
+    schedule();
+}
+
+void FrameSource::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_tasks.wait();
+}
+
+void FrameSource::schedule()
+{
+    if ( m_stop || m_decoding || m_decoderDone || static_cast<int>(m_ready.size()) >= m_prefetch ) {
+        return;
+    }
+    m_decoding = true;
+    m_tasks.run([this]{ decodeTask(); });
+}
+
+void FrameSource::decodeTask()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ( m_stop ) {
+            m_decoding = false;
+            m_readyChanged.notify_all();
+            return;
+        }
+    }
+    // the decoder is used outside of the lock, nobody else touches it while m_decoding is set
+    Slot slot;
+    bool ok = decode(slot);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready.push_back(slot);
+    if ( ! ok ) {
+        m_decoderDone = true; // the failed slot tells the consumer that the end is reached
+    }
+    m_decoding = false;
+    m_readyChanged.notify_all();
+    schedule(); // one frame per task, other sources get their turn in between
+}
+
+bool FrameSource::decode(Slot& slot)
+{
+    VIDEN_TRACE_SCOPE("decode");
+    slot.image = m_pool->take();
+    slot.frameNumber = m_decoder->position();
+    slot.ok = m_decoder->read(slot.image);
+    return slot.ok;
+}
+
+void FrameSource::lend(Slot& slot, FrameView& view)
+{
+    if ( ! slot.ok || slot.image.empty() ) {
+        m_pool->recycle(slot.image);
+        m_atEnd = true;
+        return;
+    }
+    view.m_image = slot.image;
+    view.m_frameNumber = slot.frameNumber;
+    view.m_pool = m_pool;
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,379 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+/** ***********************************************************************************************
+ * @file FrameSource.h
+ * @brief Synchronous pull access to the frames of a video or an image sequence, for offline
+ *        processing loops without signals, QVariant boxing or thread hops.
+ */
+
+// oscv
+#include "Decoder.h"
+#include "Executor.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <iterator>
+#include <cstddef>
+
+
+namespace oscv
+{
+
+class FrameSource;
+
+/**
+ * @brief The FrameView class a decoded frame lent out by a FrameSource.
+ *
+ *        The image shares the memory of a pooled buffer, nothing is copied. The buffer goes back to
+ *        the pool when the view is released, reassigned or destroyed, and the next frames are decoded
+ *        into it once no cv::Mat copy of the image is left, so copies handed on, e.g. in a QVariant,
+ *        stay valid. A view is movable, not copyable.
+ */
+class FrameView
+{
+public:
+    inline FrameView();
+
+    inline ~FrameView();
+
+    inline FrameView(FrameView&& other);
+
+    inline FrameView& operator=(FrameView&& other);
+
+    //! Decoded BGR frame, empty if the view holds no frame
+    inline const cv::Mat& image() const;
+
+    //! Position of the frame in the video or sequence
+    inline int frameNumber() const;
+
+    inline bool isValid() const;
+
+    //! Give the buffer back to the pool. It is decoded into again only when no copy of the image is left.
+    void release();
+
+private:
+    friend class FrameSource;
+
+    struct Pool;
+
+    FrameView(const FrameView&);
+    FrameView& operator=(const FrameView&);
+
+    cv::Mat m_image;
+    int m_frameNumber;
+    std::shared_ptr<Pool> m_pool;   // keeps the pool alive while a view outlives its source
+};
+
+
+/**
+ * @brief The FrameSource class hands out the frames of an IDecoder one after the other on the
+ *        calling thread.
+ *
+ *        With a prefetch depth > 0 tasks on the shared Executor decode up to that many frames ahead,
+ *        so decoding overlaps the processing of the caller. Each task decodes one frame, many sources
+ *        share the cores without a thread each. With 0 next() decodes on the calling thread.
+ *        Frames are decoded into pooled buffers which come back when the views are released, so a
+ *        loop which keeps at most a few views alive does not allocate in steady state, neither for
+ *        videos nor for image sequences, which decode into the buffer they are given.
+ *
+ *        @code
+ *        FrameSource source;
+ *        source.open("video.avi", 4);
+ *        for ( const FrameView& view : source ) {
+ *            analyze(view.image(), view.frameNumber());
+ *        }
+ *        @endcode
+ *
+ *        A FrameSource is used by one thread at a time.
+ */
+class FrameSource
+{
+public:
+    static const int DEFAULT_PREFETCH = 2;
+
+    FrameSource();
+
+    ~FrameSource();
+
+    /**
+     * @brief open a video or any image of a sequence, @see IDecoder::create()
+     * @param filename
+     * @param prefetch number of frames decoded ahead in the background, 0 decodes in next()
+     * @return false if the file cannot be opened
+     */
+    bool open(const QString& filename, int prefetch=DEFAULT_PREFETCH);
+
+    /**
+     * @brief open read from the given decoder, e.g. one with a custom read ahead
+     * @param decoder opened decoder, the source takes it over
+     * @param prefetch
+     * @return false if decoder is null or not open
+     */
+    bool open(std::unique_ptr<IDecoder> decoder, int prefetch=DEFAULT_PREFETCH);
+
+    void close();
+
+    inline bool isOpen() const;
+
+    /**
+     * @brief next wait for the next frame
+     * @param view[out] the frame, its previous buffer goes back to the pool first
+     * @return false behind the last frame or if decoding failed
+     */
+    bool next(FrameView& view);
+
+    /**
+     * @brief tryNext take the next frame if it has already been prefetched, never blocks
+     * @param view[out]
+     * @return false if no frame is ready yet or atEnd()
+     */
+    bool tryNext(FrameView& view);
+
+    /**
+     * @brief seek drop the prefetched frames and continue at the given frame
+     * @param frameNumber 0..frameCount()-1
+     * @return false if the decoder cannot seek there
+     */
+    bool seek(int frameNumber);
+
+    //! True if next() has run behind the last frame
+    inline bool atEnd() const;
+
+    /**
+     * @brief setPrefetch number of frames decoded ahead. Prefetched frames are kept.
+     * @param frames 0 decodes on the calling thread
+     */
+    void setPrefetch(int frames);
+
+    inline int prefetch() const;
+
+    //! Executor priority class of the prefetch tasks
+    void setPriority(Executor::Priority priority);
+
+    inline Executor::Priority priority() const;
+
+    inline int frameCount() const;
+
+    inline double frameRate() const;
+
+    //! Number of buffers allocated by the pool so far, stays constant in steady state
+    int allocatedBuffers() const;
+
+
+    /**
+     * @brief The iterator class input iterator for range-for loops. It holds the current view,
+     *        incrementing releases it and pulls the next frame.
+     */
+    class iterator
+    {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef FrameView value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const FrameView* pointer;
+        typedef const FrameView& reference;
+
+        inline iterator();
+
+        inline explicit iterator(FrameSource* source);
+
+        inline const FrameView& operator*() const;
+
+        inline const FrameView* operator->() const;
+
+        inline iterator& operator++();
+
+        inline bool operator==(const iterator& other) const;
+
+        inline bool operator!=(const iterator& other) const;
+
+    private:
+        FrameSource* m_source;   // null at the end
+        FrameView m_view;
+    };
+
+    //! Starts at the current position
+    inline iterator begin();
+
+    inline iterator end();
+
+
+private:
+    struct Slot
+    {
+        cv::Mat image;
+        int frameNumber;
+        bool ok;
+    };
+
+    FrameSource(const FrameSource&);
+    FrameSource& operator=(const FrameSource&);
+
+    void start();
+
+    void stop();
+
+    //! Submit a decode task if there is room for another frame, m_mutex is locked
+    void schedule();
+
+    void decodeTask();
+
+    bool decode(Slot& slot);
+
+    void lend(Slot& slot, FrameView& view);
+
+    std::unique_ptr<IDecoder> m_decoder;
+    std::shared_ptr<FrameView::Pool> m_pool;
+    int m_prefetch;
+    int m_frameCount;
+    double m_frameRate;
+    bool m_atEnd;
+
+    // prefetch, the decoder belongs to the decode task while one is in flight
+    TaskGroup m_tasks;
+    bool m_stop;
+    bool m_decoding;         // a decode task is in flight
+    bool m_decoderDone;      // the last frame has been queued
+    std::deque<Slot> m_ready;
+    std::mutex m_mutex;
+    std::condition_variable m_readyChanged;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+FrameView::FrameView()
+    : m_frameNumber(-1)
+{
+}
+
+FrameView::~FrameView()
+{
+    release();
+}
+
+FrameView::FrameView(FrameView&& other)
+    : m_image(other.m_image)
+    , m_frameNumber(other.m_frameNumber)
+    , m_pool(std::move(other.m_pool))
+{
+    other.m_image = cv::Mat();
+    other.m_frameNumber = -1;
+}
+
+FrameView& FrameView::operator=(FrameView&& other)
+{
+    if ( this != &other ) {
+        release();
+        m_image = other.m_image;
+        m_frameNumber = other.m_frameNumber;
+        m_pool = std::move(other.m_pool);
+        other.m_image = cv::Mat();
+        other.m_frameNumber = -1;
+    }
+    return *this;
+}
+
+const cv::Mat& FrameView::image() const
+{
+    return m_image;
+}
+
+int FrameView::frameNumber() const
+{
+    return m_frameNumber;
+}
+
+bool FrameView::isValid() const
+{
+    return m_image.data != NULL;
+}
+
+
+bool FrameSource::isOpen() const
+{
+    return m_decoder != nullptr;
+}
+
+bool FrameSource::atEnd() const
+{
+    return m_atEnd;
+}
+
+int FrameSource::prefetch() const
+{
+    return m_prefetch;
+}
+
+Executor::Priority FrameSource::priority() const
+{
+    return m_tasks.priority();
+}
+
+int FrameSource::frameCount() const
+{
+    return m_frameCount;
+}
+
+double FrameSource::frameRate() const
+{
+    return m_frameRate;
+}
+
+FrameSource::iterator FrameSource::begin()
+{
+    return iterator(this);
+}
+
+FrameSource::iterator FrameSource::end()
+{
+    return iterator();
+}
+
+
+FrameSource::iterator::iterator()
+    : m_source(nullptr)
+{
+}
+
+FrameSource::iterator::iterator(FrameSource* source)
+    : m_source(source)
+{
+    if ( m_source && ! m_source->next(m_view) ) {
+        m_source = nullptr;
+    }
+}
+
+const FrameView& FrameSource::iterator::operator*() const
+{
+    return m_view;
+}
+
+const FrameView* FrameSource::iterator::operator->() const
+{
+    return &m_view;
+}
+
+FrameSource::iterator& FrameSource::iterator::operator++()
+{
+    if ( m_source && ! m_source->next(m_view) ) {
+        m_source = nullptr;
+    }
+    return *this;
+}
+
+bool FrameSource::iterator::operator==(const iterator& other) const
+{
+    return m_source == other.m_source;
+}
+
+bool FrameSource::iterator::operator!=(const iterator& other) const
+{
+    return m_source != other.m_source;
+}
+
+}
+#endif // FRAMESOURCE_H
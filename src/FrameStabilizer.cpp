@@ -0,0 +1,154 @@
+#include "FrameStabilizer.h"
+#include "OcvUtils.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace oscv;
+
+
+FrameStabilizer::FrameStabilizer()
+    : m_workingWidth(DEFAULT_WORKING_WIDTH)
+    , m_smoothing(0.9)
+    , m_minResponse(0.05)
+    , m_hasReference(false)
+    , m_scale(1.0)
+    , m_lastResponse(0.0)
+{
+    m_warp = cv::Mat::eye(2, 3, CV_64F);
+}
+
+void FrameStabilizer::reset()
+{
+    m_hasReference = false;
+    m_lastShift = cv::Point2d();
+    m_lastResponse = 0.0;
+    m_trajectory = cv::Point2d();
+    m_smoothed = cv::Point2d();
+    m_correction = cv::Point2d();
+}
+
+void FrameStabilizer::setWorkingWidth(int width)
+{
+    m_workingWidth = std::max(width, 16);
+    m_frameSize = cv::Size();
+    reset();
+}
+
+bool FrameStabilizer::estimate(const cv::Mat& frame, cv::Point2d& shift)
+{
+    shift = cv::Point2d();
+    if ( frame.empty() || ! prepare(frame) ) {
+        return false;
+    }
+
+    cv::dft(m_padded, m_spectrum, cv::DFT_COMPLEX_OUTPUT);
+    bool ok = m_hasReference;
+    if ( ok ) {
+        // normalized cross power spectrum, its inverse has a peak at the displacement
+        cv::mulSpectrums(m_spectrum, m_reference, m_cross, 0, true);
+        for ( int i=0; i<m_cross.rows; ++i ) {
+            cv::Vec2f* c = m_cross.ptr<cv::Vec2f>(i);
+            for ( int j=0; j<m_cross.cols; ++j ) {
+                float mag = std::sqrt(c[j][0]*c[j][0] + c[j][1]*c[j][1]) + 1e-9f;
+                c[j][0] /= mag;
+                c[j][1] /= mag;
+            }
+        }
+        cv::dft(m_cross, m_correlation, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+        OcvUtils::ShiftDft(m_correlation);
+
+        double response = 0.0;
+        cv::Point2d peak = peakLocation(response);
+        m_lastResponse = response;
+        if ( response >= m_minResponse ) {
+            shift = cv::Point2d( (peak.x - m_dftSize.width/2)*m_scale, (peak.y - m_dftSize.height/2)*m_scale );
+        }
+    }
+    // this spectrum is the reference of the next frame
+    cv::swap(m_spectrum, m_reference);
+    m_hasReference = true;
+    m_lastShift = shift;
+    return ok;
+}
+
+bool FrameStabilizer::stabilize(const cv::Mat& frame, cv::Mat& out)
+{
+    cv::Point2d shift;
+    if ( frame.empty() ) {
+        return false;
+    }
+    estimate(frame, shift);
+
+    m_trajectory += shift;
+    m_smoothed = m_smoothed*m_smoothing + m_trajectory*(1.0-m_smoothing);
+    m_correction = m_smoothed - m_trajectory;
+
+    m_warp.at<double>(0,2) = m_correction.x;
+    m_warp.at<double>(1,2) = m_correction.y;
+    cv::warpAffine(frame, out, m_warp, frame.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Gray, downscale and window the frame into m_padded. Set up the buffers on the first frame.
+bool FrameStabilizer::prepare(const cv::Mat& frame)
+{
+    if ( frame.size() != m_frameSize ) {
+        m_frameSize = frame.size();
+        int width = std::min(m_workingWidth, frame.cols);
+        m_scale = static_cast<double>(frame.cols)/width;
+        m_workSize = cv::Size(width, std::max(1, cvRound(frame.rows/m_scale)));
+
+        // ShiftDft moves the origin to (cols/2, rows/2) for even sizes
+        int w = cv::getOptimalDFTSize(m_workSize.width);
+        int h = cv::getOptimalDFTSize(m_workSize.height);
+        while ( w % 2 ) w = cv::getOptimalDFTSize(w+1);
+        while ( h % 2 ) h = cv::getOptimalDFTSize(h+1);
+        m_dftSize = cv::Size(w, h);
+
+        cv::createHanningWindow(m_window, m_workSize, CV_32F);
+        m_padded = cv::Mat::zeros(m_dftSize, CV_32F);
+        m_hasReference = false;
+    }
+
+    const cv::Mat* gray = &m_gray;
+    switch ( frame.channels() ) {
+        case 1: gray = &frame; break;
+        case 3: cv::cvtColor(frame, m_gray, cv::COLOR_BGR2GRAY); break;
+        case 4: cv::cvtColor(frame, m_gray, cv::COLOR_BGRA2GRAY); break;
+        default: return false;
+    }
+    cv::resize(*gray, m_small, m_workSize, 0, 0, cv::INTER_AREA);
+    cv::Mat roi = m_padded(cv::Rect(0, 0, m_workSize.width, m_workSize.height));
+    m_small.convertTo(roi, CV_32F);
+    cv::multiply(roi, m_window, roi);
+    return true;
+}
+
+// Weighted centroid of the 3x3 neighbourhood of the correlation maximum
+cv::Point2d FrameStabilizer::peakLocation(double& response)
+{
+    cv::Point maxLoc;
+    cv::minMaxLoc(m_correlation, 0, &response, 0, &maxLoc);
+
+    double sum = 0.0, x = 0.0, y = 0.0;
+    for ( int i=std::max(0, maxLoc.y-1); i<=std::min(m_correlation.rows-1, maxLoc.y+1); ++i ) {
+        const float* c = m_correlation.ptr<float>(i);
+        for ( int j=std::max(0, maxLoc.x-1); j<=std::min(m_correlation.cols-1, maxLoc.x+1); ++j ) {
+            double v = std::max(0.0f, c[j]);
+            sum += v;
+            x += v*j;
+            y += v*i;
+        }
+    }
+    if ( sum <= 0.0 ) {
+        return cv::Point2d(maxLoc.x, maxLoc.y);
+    }
+    return cv::Point2d(x/sum, y/sum);
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
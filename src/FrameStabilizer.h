@@ -0,0 +1,156 @@
+#ifndef FRAMESTABILIZER_H
+#define FRAMESTABILIZER_H
+
+/** ***********************************************************************************************
+ * @file FrameStabilizer.h
+ * @brief Translation only video stabilization with FFT phase correlation between consecutive frames.
+ */
+
+// CV
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+namespace oscv
+{
+    /**
+     * @brief The FrameStabilizer class estimates the translation between consecutive frames and
+     *        warps every frame towards a smoothed camera path.
+     *
+     *        Frames are converted to gray and downscaled to the working width before the phase
+     *        correlation. The DFT size, the Hanning window and all buffers are kept between frames and
+     *        the spectrum of a frame is reused as reference for the next one, so each frame costs one
+     *        forward and one inverse DFT of the downscaled size.
+     *        The object is not thread safe, use one stabilizer per stream.
+     */
+    class FrameStabilizer
+    {
+    public:
+        /**
+         * @brief DEFAULT_WORKING_WIDTH Width of the downscaled frame used for the registration.
+         */
+        static const int DEFAULT_WORKING_WIDTH = 320;
+
+        FrameStabilizer();
+
+        /**
+         * @brief estimate translation of the given frame relative to the previous one.
+         *        The first frame after construction or reset() has no reference and gives (0,0).
+         * @param frame 8U, 16U or 32F frame with 1, 3 or 4 channels (BGR)
+         * @param shift[out] displacement of the content in pixels of the given frame
+         * @return false if the frame is empty or there was no reference frame.
+         */
+        bool estimate(const cv::Mat& frame, cv::Point2d& shift);
+
+        /**
+         * @brief stabilize estimate the motion and warp the frame towards the smoothed camera path.
+         * @param frame input frame
+         * @param out stabilized frame, the buffer is reused. Must not share data with frame.
+         * @return false if the frame is empty
+         */
+        bool stabilize(const cv::Mat& frame, cv::Mat& out);
+
+        /**
+         * @brief reset forget the reference frame and the camera path, e.g. after a seek.
+         */
+        void reset();
+
+        /**
+         * @brief setWorkingWidth width of the downscaled registration frame. Resets the stabilizer.
+         * @param width at least 16 pixels
+         */
+        void setWorkingWidth(int width);
+
+        /**
+         * @brief setSmoothing weight of the previous smoothed path position
+         * @param smoothing 0 keeps the camera path as it is, close to 1 holds the view still.
+         */
+        inline void setSmoothing(double smoothing);
+
+        /**
+         * @brief setMinResponse correlation peaks below this value are treated as no motion.
+         * @param response between 0 and 1
+         */
+        inline void setMinResponse(double response);
+
+        inline int workingWidth() const;
+
+        //! Displacement found for the last frame
+        inline cv::Point2d lastShift() const;
+
+        //! Height of the correlation peak of the last frame (0..1)
+        inline double lastResponse() const;
+
+        //! Translation applied to the last stabilized frame
+        inline cv::Point2d correction() const;
+
+
+    private:
+        bool prepare(const cv::Mat& frame);
+
+        cv::Point2d peakLocation(double& response);
+
+
+        int m_workingWidth;
+        double m_smoothing;
+        double m_minResponse;
+        bool m_hasReference;
+
+        cv::Size m_frameSize;   // size of the frames the buffers were set up for
+        cv::Size m_workSize;    // downscaled size
+        cv::Size m_dftSize;     // even DFT size >= m_workSize
+        double m_scale;         // frame pixels per working pixel
+
+        cv::Mat m_gray;
+        cv::Mat m_small;
+        cv::Mat m_window;
+        cv::Mat m_padded;
+        cv::Mat m_spectrum;
+        cv::Mat m_reference;
+        cv::Mat m_cross;
+        cv::Mat m_correlation;
+        cv::Mat m_warp;
+
+        cv::Point2d m_lastShift;
+        double m_lastResponse;
+        cv::Point2d m_trajectory;
+        cv::Point2d m_smoothed;
+        cv::Point2d m_correction;
+    };
+
+    ///////////////////////////////////////INLINE
+
+    void FrameStabilizer::setSmoothing(double smoothing)
+    {
+        m_smoothing = smoothing;
+    }
+
+    void FrameStabilizer::setMinResponse(double response)
+    {
+        m_minResponse = response;
+    }
+
+    int FrameStabilizer::workingWidth() const
+    {
+        return m_workingWidth;
+    }
+
+    cv::Point2d FrameStabilizer::lastShift() const
+    {
+        return m_lastShift;
+    }
+
+    double FrameStabilizer::lastResponse() const
+    {
+        return m_lastResponse;
+    }
+
+    cv::Point2d FrameStabilizer::correction() const
+    {
+        return m_correction;
+    }
+
+} // end namespace
+
+#endif // FRAMESTABILIZER_H
+/////////////////////////////////////////////END OF FILE //////////////////////////////////////////////////
@@ -0,0 +1,175 @@
+#include "HashIndex.h"
+
+// Qt
+#include <QFile>
+#include <QDataStream>
+#include <QSaveFile>
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+const char* const HashIndex::FILE_EXTENSION = ".vhash";
+
+namespace
+{
+    const quint32 INDEX_MAGIC = 0x56484958; // "VHIX"
+    const qint32 INDEX_VERSION = 1;
+
+    bool nearerFirst(const HashIndex::Match& a, const HashIndex::Match& b)
+    {
+        if ( a.distance != b.distance ) {
+            return a.distance < b.distance;
+        }
+        return a.clip != b.clip ? a.clip < b.clip : a.frameNumber < b.frameNumber;
+    }
+}
+
+
+HashIndex::HashIndex()
+{
+}
+
+int HashIndex::addClip(const QString& name)
+{
+    m_clips.append(name);
+    return m_clips.size() - 1;
+}
+
+void HashIndex::add(int frameNumber, quint64 hash)
+{
+    if ( m_clips.isEmpty() ) {
+        addClip("");
+    }
+    m_hashes.push_back(hash);
+    m_frames.push_back(frameNumber);
+    m_clipOf.push_back(m_clips.size() - 1);
+}
+
+std::vector<HashIndex::Match> HashIndex::find(quint64 hash, int maxDistance, int maxResults) const
+{
+    std::vector<Match> matches;
+    const quint64* hashes = m_hashes.data();
+    const size_t n = m_hashes.size();
+    for ( size_t i=0; i<n; ++i )
+    {
+        int d = FrameHash::distance(hash, hashes[i]);
+        if ( d <= maxDistance ) {
+            Match m;
+            m.clip = m_clipOf[i];
+            m.frameNumber = m_frames[i];
+            m.distance = d;
+            matches.push_back(m);
+        }
+    }
+    if ( maxResults >= 0 && static_cast<int>(matches.size()) > maxResults ) {
+        std::partial_sort(matches.begin(), matches.begin() + maxResults, matches.end(), nearerFirst);
+        matches.resize(maxResults);
+    }
+    else {
+        std::sort(matches.begin(), matches.end(), nearerFirst);
+    }
+    return matches;
+}
+
+bool HashIndex::nearest(quint64 hash, Match& match) const
+{
+    if ( m_hashes.empty() ) {
+        return false;
+    }
+    size_t best = 0;
+    int bestDistance = 65;
+    for ( size_t i=0; i<m_hashes.size() && bestDistance > 0; ++i )
+    {
+        int d = FrameHash::distance(hash, m_hashes[i]);
+        if ( d < bestDistance ) {
+            bestDistance = d;
+            best = i;
+        }
+    }
+    match.clip = m_clipOf[best];
+    match.frameNumber = m_frames[best];
+    match.distance = bestDistance;
+    return true;
+}
+
+bool HashIndex::contains(quint64 hash, int maxDistance) const
+{
+    for ( size_t i=0; i<m_hashes.size(); ++i ) {
+        if ( FrameHash::distance(hash, m_hashes[i]) <= maxDistance ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HashIndex::merge(const HashIndex& other)
+{
+    const int offset = m_clips.size();
+    m_clips.append(other.m_clips);
+    m_hashes.insert(m_hashes.end(), other.m_hashes.begin(), other.m_hashes.end());
+    m_frames.insert(m_frames.end(), other.m_frames.begin(), other.m_frames.end());
+    m_clipOf.reserve(m_clipOf.size() + other.m_clipOf.size());
+    for ( size_t i=0; i<other.m_clipOf.size(); ++i ) {
+        m_clipOf.push_back(other.m_clipOf[i] + offset);
+    }
+}
+
+void HashIndex::clear()
+{
+    m_hashes.clear();
+    m_frames.clear();
+    m_clipOf.clear();
+    m_clips.clear();
+}
+
+bool HashIndex::save(const QString& filename) const
+{
+    QSaveFile file(filename);
+    if ( ! file.open(QIODevice::WriteOnly) ) {
+        return false;
+    }
+    QDataStream out(&file);
+    out << INDEX_MAGIC << INDEX_VERSION << m_clips << static_cast<quint32>(m_hashes.size());
+    for ( size_t i=0; i<m_hashes.size(); ++i ) {
+        out << m_hashes[i] << m_frames[i] << m_clipOf[i];
+    }
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool HashIndex::load(const QString& filename)
+{
+    clear();
+    QFile file(filename);
+    if ( ! file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QDataStream in(&file);
+    quint32 magic, count;
+    qint32 version;
+    in >> magic >> version;
+    if ( magic != INDEX_MAGIC || version != INDEX_VERSION ) {
+        return false;
+    }
+    in >> m_clips >> count;
+    if ( in.status() != QDataStream::Ok || count > file.size() / 16 ) { // 16 bytes per frame
+        clear();
+        return false;
+    }
+    m_hashes.resize(count);
+    m_frames.resize(count);
+    m_clipOf.resize(count);
+    bool valid = true;
+    for ( quint32 i=0; i<count; ++i ) {
+        in >> m_hashes[i] >> m_frames[i] >> m_clipOf[i];
+        valid = valid && m_clipOf[i] >= 0 && m_clipOf[i] < m_clips.size();
+    }
+    if ( in.status() != QDataStream::Ok || ! valid ) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
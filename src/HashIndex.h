@@ -0,0 +1,146 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+/** ***********************************************************************************************
+ * @file HashIndex.h
+ * @brief Compact store of frame hashes of one or more clips with Hamming distance lookups.
+ */
+
+// Qt
+#include <QString>
+#include <QStringList>
+
+// oscv
+#include "FrameHash.h"
+
+#include <vector>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The HashIndex class keeps the FrameHash of frames, 16 bytes per frame, and finds the frames
+ *        whose hash is within a Hamming distance of a query.
+ *
+ *        Lookups scan all hashes with one xor and popcount each, a million frames take about a
+ *        millisecond, no decoding involved. Per clip indices are written next to the extracted frames
+ *        (save()) and merged for searches across clips:
+ *        @code
+ *        HashIndex all;
+ *        foreach ( const QString& file, indexFiles ) {
+ *            HashIndex clip;
+ *            if ( clip.load(file) ) all.merge(clip);
+ *        }
+ *        std::vector<HashIndex::Match> matches = all.find(FrameHash().compute(frame), 6);
+ *        @endcode
+ */
+class HashIndex
+{
+public:
+    struct Match
+    {
+        int clip;          // index into clips()
+        int frameNumber;
+        int distance;
+    };
+
+    //! Default file extension of save(), e.g. clip.mp4.vhash
+    static const char* const FILE_EXTENSION;
+
+    HashIndex();
+
+    /**
+     * @brief addClip start the frames of another clip, add() appends to the last clip
+     * @param name e.g. the path of the video
+     * @return index of the clip
+     */
+    int addClip(const QString& name);
+
+    /**
+     * @brief add the hash of a frame of the last clip, a clip "" is started if there is none
+     * @param frameNumber
+     * @param hash
+     */
+    void add(int frameNumber, quint64 hash);
+
+    /**
+     * @brief find the frames within the given distance of the hash, nearest first
+     * @param hash
+     * @param maxDistance 0..64, e.g. 6 for near duplicates
+     * @param maxResults -1 for all
+     */
+    std::vector<Match> find(quint64 hash, int maxDistance, int maxResults=-1) const;
+
+    /**
+     * @brief nearest frame to the hash
+     * @param hash
+     * @param match[out]
+     * @return false if the index is empty
+     */
+    bool nearest(quint64 hash, Match& match) const;
+
+    /**
+     * @brief contains true if a frame is within the given distance, e.g. to skip duplicates while
+     *        extracting. Stops at the first such frame.
+     */
+    bool contains(quint64 hash, int maxDistance) const;
+
+    //! Append the clips and frames of another index
+    void merge(const HashIndex& other);
+
+    void clear();
+
+    inline int size() const;
+
+    inline quint64 hash(int i) const;
+
+    inline int frameNumber(int i) const;
+
+    inline int clipOf(int i) const;
+
+    inline const QStringList& clips() const;
+
+    //! Write the index to a file, replaced atomically
+    bool save(const QString& filename) const;
+
+    //! Read an index written by save(), replaces the content
+    bool load(const QString& filename);
+
+private:
+    // one array per field, the lookups only stream through m_hashes
+    std::vector<quint64> m_hashes;
+    std::vector<qint32> m_frames;
+    std::vector<qint32> m_clipOf;
+    QStringList m_clips;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+int HashIndex::size() const
+{
+    return static_cast<int>(m_hashes.size());
+}
+
+quint64 HashIndex::hash(int i) const
+{
+    return m_hashes[i];
+}
+
+int HashIndex::frameNumber(int i) const
+{
+    return m_frames[i];
+}
+
+int HashIndex::clipOf(int i) const
+{
+    return m_clipOf[i];
+}
+
+const QStringList& HashIndex::clips() const
+{
+    return m_clips;
+}
+
+}
+#endif // HASHINDEX_H
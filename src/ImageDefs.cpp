@@ -25,6 +25,7 @@ QSet<QString> ImageDefs::getSupportFormats()
     formats.insert("tiff");
     formats.insert("tif");
     formats.insert("png");
+    formats.insert("vraw"); // RawFrame
     return formats;
 }
 
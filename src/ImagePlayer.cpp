@@ -1,15 +1,17 @@
 #include "ImagePlayer.h"
 
 // Qt
-#include <QApplication>
 #include <QMutexLocker>
+#include <QFileInfo>
 
 // oscv
 #include "VideoDefs.h"
 #include "FileUtils.h"
 #include "StringUtils.h"
 #include "TimeUtils.h"
+#include "Tracer.h"
 #include "ImageUtils.h"
+#include "OcvUtils.h"
 // cv
 #ifdef OPENCV_3
 #include <opencv2/highgui.hpp> //imread
@@ -17,20 +19,27 @@
 #include <opencv2/highgui/highgui.hpp>
 #endif
 
+#include <algorithm>
+
 using namespace oscv;
 
 ImagePlayer::ImagePlayer(QObject *parent)
     : QThread(parent)
     , m_stop(true)
     , m_name("")
-    , m_filepath("")
-    , m_prefix("")
-    , m_fileExt("")
     , m_frameNumber(0)
     , m_totalFrames(0)
     , m_speed(Speed::Fast)
+    , m_stabilize(false)
+    , m_gated(false)
+    , m_follow(false)
+    , m_followLag(DEFAULT_FOLLOW_LAG)
+    , m_stage(NULL)
 {
       qRegisterMetaType<cv::Mat>("cv::Mat");
+      qRegisterMetaType<PlayerMetrics::Snapshot>("oscv::PlayerMetrics::Snapshot");
+      connect(&m_watcher, &SequenceWatcher::fileAdded, this, &ImagePlayer::addFrame, Qt::DirectConnection);
+      connect(&m_watcher, &SequenceWatcher::eventsLost, this, &ImagePlayer::reindex, Qt::DirectConnection);
 }
 
 ImagePlayer::~ImagePlayer()
@@ -40,13 +49,13 @@ ImagePlayer::~ImagePlayer()
 
 void ImagePlayer::close()
 {
+    m_watcher.unwatch(); // before locking, the watcher thread may wait for the mutex
     m_mutex.lock();
     m_stop = true;
     m_frameNumber = 0;
     init("");
     m_mutex.unlock();
-    m_waitCondition.wakeOne();
-    //condition.wakeAll();
+    m_waitCondition.wakeAll();
     wait();
 }
 
@@ -54,12 +63,16 @@ void ImagePlayer::close()
 
 bool ImagePlayer::open(QString filename)
 {
+    m_stabilizer.reset();
+    m_watcher.unwatch();
     bool ok = init(filename);
     ok = ok && readFrame();
+    if ( ok && m_follow && m_watcher.watch(m_decoder.index()) ) {
+        reindex(); // files closed between the scan and the watch have no event
+    }
     if ( ok )
     {
-        m_variant.setValue( m_frame );
-        emit newFrame( m_variant, m_frameNumber );
+        emitSingleFrame();
     }
     return ok;
 }
@@ -91,14 +104,13 @@ bool ImagePlayer::go(int relativeFrame)
   if ( ok )
   {
         m_mutex.lock();
+        m_stabilizer.reset(); // not consecutive to the previous frame anymore
+        VIDEN_TRACE_SCOPE("seek");
         ok = readFrame();
         m_mutex.unlock();
         if (ok )
         {
-            m_mutex.lock();
-            m_variant.setValue( m_frame );
-            m_mutex.unlock();
-            emit newFrame( m_variant, m_frameNumber );
+            emitSingleFrame();
         }
   }
   return ok;
@@ -106,37 +118,173 @@ bool ImagePlayer::go(int relativeFrame)
 }
 
 
+void ImagePlayer::setProcessingStage(ProcessingStage* stage)
+{
+    QMutexLocker locker(&m_mutex);
+    if ( m_stage ) {
+        m_stage->clear();
+    }
+    m_stage = stage;
+}
+
+void ImagePlayer::setChangeGate(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_gated = enable;
+    m_changeGate.reset();
+}
+
+void ImagePlayer::setStabilization(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stabilize = enable;
+    m_stabilizer.reset();
+}
+
+
+bool ImagePlayer::setFollowMode(bool follow, int lagFrames)
+{
+    if ( follow && ! SequenceWatcher::isSupported() ) {
+        return false;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_followLag = std::max(0, lagFrames);
+        if ( follow && m_follow && m_watcher.isWatching() ) {
+            // keep the running watch, no event may be missed
+            m_waitCondition.wakeAll();
+            return true;
+        }
+    }
+    m_watcher.unwatch(); // before locking, the watcher thread may wait for the mutex
+    QMutexLocker locker(&m_mutex);
+    m_follow = follow;
+    if ( m_follow && m_decoder.isOpen() ) {
+        m_follow = m_watcher.watch(m_decoder.index());
+        if ( m_follow ) {
+            updateIndex(); // files closed before the watch have no event
+        }
+    }
+    m_waitCondition.wakeAll();
+    return m_follow == follow;
+}
+
+
+void ImagePlayer::setReadAhead(int frames)
+{
+    QMutexLocker locker(&m_mutex);
+    m_decoder.setReadAhead(frames);
+}
+
+void ImagePlayer::setReadFlags(int flags)
+{
+    QMutexLocker locker(&m_mutex);
+    m_decoder.setReadFlags(flags);
+}
+
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// Protected
 ///
 
 void ImagePlayer::run()
 {
+    VIDEN_TRACE_THREAD_NAME("ImagePlayer");
     int delay = static_cast<int>(m_speed)/getFrameRate();
     bool ok = true;
     while( !m_stop )
     {
-        m_mutex.lock();
+#if VIDEN_ENABLE_METRICS
+        quint64 frameStart = PlayerMetrics::now();
+#endif
+        VIDEN_METRICS_LOCK(m_metrics, m_mutex);
+        // follow mode: wait until the writer is m_followLag frames ahead of the next frame
+        while ( m_follow && ! m_stop && m_frameNumber+1 >= m_totalFrames-m_followLag ) {
+            m_waitCondition.wait(&m_mutex);
+        }
+        if ( m_stop ) {
+            m_mutex.unlock();
+            break;
+        }
         m_frameNumber++;
-        ok = readFrame( );
+        {
+            VIDEN_METRICS_SCOPE(m_metrics, Decode);
+            ok = decodeFrame();
+        }
         m_mutex.unlock();
         if ( !ok ) {
-              m_mutex.lock();
+              VIDEN_METRICS_LOCK(m_metrics, m_mutex);
               m_stop = true;
+              ProcessingStage* stage = m_stage;
               m_mutex.unlock();
+              if ( stage ) {
+                  emitProcessed(stage, true); // the frames still in the stage
+              }
              emit donePlay(m_stop);
 
         }
         if ( ! m_stop ) {
-             m_mutex.lock();
+             VIDEN_METRICS_LOCK(m_metrics, m_mutex);
              delay = static_cast<int>(m_speed)/getFrameRate();
-             m_variant.setValue( m_frame );
-             m_mutex.unlock();
-             emit newFrame( m_variant, m_frameNumber );
+             if ( m_stabilize ) {
+                 VIDEN_METRICS_SCOPE(m_metrics, Process);
+                 if ( OcvUtils::isShared(m_stabilized) ) {
+                     m_stabilized.release(); // the last emitted frame, receivers may still read it
+                 }
+                 m_stabilizer.stabilize(m_frame, m_stabilized);
+             }
+             const cv::Mat& frame = m_stabilize ? m_stabilized : m_frame;
+             bool skip = false;
+             if ( m_gated ) {
+                 VIDEN_METRICS_SCOPE(m_metrics, Process);
+                 skip = ! m_changeGate.accept(frame);
+             }
+             ProcessingStage* stage = m_stage;
+             if ( skip ) {
+                 m_mutex.unlock();
+                 VIDEN_METRICS_COUNT(m_metrics, Skipped);
+             }
+             else if ( stage ) {
+                 stage->push(frame, m_frameNumber); // copies, the stage is never full here
+                 m_mutex.unlock();
+                 emitProcessed(stage, false);
+             }
+             else {
+                 {
+                     VIDEN_METRICS_SCOPE(m_metrics, Wrap);
+                     m_variant.setValue( frame );
+                 }
+                 int frameNumber = m_frameNumber;
+                 m_mutex.unlock();
+                 VIDEN_METRICS_SCOPE(m_metrics, Emit);
+                 VIDEN_TRACE_SCOPE("emit");
+                 emit newFrame( m_variant, frameNumber );
+             }
+#if VIDEN_ENABLE_METRICS
+             if ( ! skip ) {
+                 m_metrics.frameDone(frameStart, delay); // gated frames only count as Skipped
+             }
+             if ( m_metrics.reportDue() ) {
+                 emit metricsUpdated( m_metrics.snapshot() );
+             }
+#endif
+        }
+        VIDEN_METRICS_SCOPE(m_metrics, Sleep);
+        VIDEN_TRACE_SCOPE("sleep");
+        if ( delay > 0 ) {
+            sleepMiliSecond(delay);
+        }
+        else {
+            yieldCurrentThread(); // Speed::Fast, let the other streams have the core
         }
-        sleepMiliSecond(delay);
     }
 
+    m_mutex.lock();
+    ProcessingStage* stage = ok ? m_stage : NULL; // stopped, a failed read has drained it already
+    m_mutex.unlock();
+    if ( stage ) {
+        emitProcessed(stage, true); // the frames still in the stage
+    }
 }
 
 
@@ -144,37 +292,131 @@ void ImagePlayer::run()
 //////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void ImagePlayer::addFrame(int number)
+{
+    QMutexLocker locker(&m_mutex);
+    int pos = m_decoder.insert(number);
+    if ( pos == VideoDefs::INVALID_FRAME_NUMBER ) {
+        return;
+    }
+    if ( pos <= m_frameNumber ) {
+        m_frameNumber++; // keep the current frame
+    }
+    m_totalFrames = m_decoder.frameCount();
+    m_waitCondition.wakeAll();
+}
+
+// Only after an inotify queue overflow, the index cannot be updated from events anymore
+void ImagePlayer::reindex()
+{
+    QMutexLocker locker(&m_mutex);
+    updateIndex();
+}
+
+// Read the directory again and keep the current frame, m_mutex must be locked
+void ImagePlayer::updateIndex()
+{
+    int pos = m_decoder.reindex(m_frameNumber);
+    if ( pos != VideoDefs::INVALID_FRAME_NUMBER ) {
+        m_frameNumber = pos;
+    }
+    m_totalFrames = m_decoder.frameCount();
+    m_waitCondition.wakeAll();
+}
+
 // filename must be exist before calling this function
 bool ImagePlayer::init(QString filename)
 {
     m_name = filename;
-    m_filepath = FileUtils::getFilePathWithSeparator(filename);
-    QString frameNumber;
-    m_prefix = FileUtils::getNamePrefix(filename, frameNumber);
-    m_frameNumber = frameNumber.toInt();
-    m_totalFrames = FileUtils::getNumberOfSequences(filename);
-    m_fileExt = FileUtils::getExtension(filename);
+    m_frameNumber = 0;
+    m_totalFrames = 0;
+    if ( ! m_name.compare("") || ! m_decoder.open(filename) ) {
+        m_decoder.close();
+        return false;
+    }
+    // the frame number is the position in the sequence, gaps in the file numbers are skipped
+    m_frameNumber = m_decoder.position();
+    m_totalFrames = m_decoder.frameCount();
 
-    return ( !m_name.compare("")? false: true );
+    return true;
 }
 
 
 bool ImagePlayer::readFrame()
 {
 
-    if ( m_frameNumber > m_totalFrames ) {
+    if ( m_frameNumber < 0 || m_frameNumber >= m_totalFrames ) {
         return false;
     }
-   QString num;
-   beautifyNumberToString(m_frameNumber, ImageDefs::NUMBER_OF_IMAGESEQ_DIGITS, num);
-   m_name = m_filepath;
-   m_name.append(m_prefix).append(num).append(".").append(m_fileExt);
-   m_frame = cv::imread(m_name.toStdString());
-   if ( m_frame.data == 0 || m_frame.data == nullptr ) {
-       return false;
+   bool ok = m_decoder.seek(m_frameNumber) && m_decoder.read(m_frame);
+   m_name = m_decoder.name();
+   if ( m_decoder.lastReadCached() ) {
+       VIDEN_METRICS_COUNT(m_metrics, CacheHits);
    }
+   else {
+       VIDEN_METRICS_COUNT(m_metrics, CacheMisses);
+   }
+   return ok;
+}
 
-   return true;
+// Emit m_frame after open() or go(), through the processing stage if there is one
+// The decoding of all players shares the cores of the executor instead of running on a thread each
+bool ImagePlayer::decodeFrame()
+{
+    bool ok = false;
+    m_decodeTasks.run([this, &ok]
+    {
+        VIDEN_TRACE_SCOPE("decode");
+        ok = readFrame();
+    });
+    m_decodeTasks.wait();
+    return ok;
+}
+
+void ImagePlayer::emitSingleFrame()
+{
+    m_mutex.lock();
+    if ( m_gated ) {
+        m_changeGate.reset(); // the played frames are compared with this one
+        m_changeGate.accept(m_frame);
+    }
+    ProcessingStage* stage = m_stage;
+    int frameNumber = m_frameNumber;
+    if ( stage ) {
+        stage->clear(); // frames of the old position
+        stage->push(m_frame, frameNumber);
+    }
+    else {
+        m_variant.setValue( m_frame );
+    }
+    m_mutex.unlock();
+    if ( stage ) {
+        emitProcessed(stage, true);
+    }
+    else {
+        emit newFrame( m_variant, frameNumber );
+    }
+}
+
+// Emit the filtered frames which are ready, all if drain is set, at least one if the stage is full
+void ImagePlayer::emitProcessed(ProcessingStage* stage, bool drain)
+{
+    cv::Mat result;
+    int frameNumber;
+    while ( stage->inFlight() > 0 && (drain || stage->isFull() || stage->isReady()) )
+    {
+        if ( ! stage->pop(result, frameNumber) ) {
+            break; // all dropped by the filter
+        }
+        {
+            VIDEN_METRICS_LOCK(m_metrics, m_mutex);
+            m_variant.setValue( result );
+            m_mutex.unlock();
+        }
+        VIDEN_METRICS_SCOPE(m_metrics, Emit);
+        VIDEN_TRACE_SCOPE("emit");
+        emit newFrame( m_variant, frameNumber );
+    }
 }
 
 
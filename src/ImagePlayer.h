@@ -26,6 +26,12 @@
 // oscv
 #include "Player.h"
 #include "VideoDefs.h"
+#include "FrameStabilizer.h"
+#include "ChangeGate.h"
+#include "ImageSequenceDecoder.h"
+#include "SequenceWatcher.h"
+#include "PlayerMetrics.h"
+#include "ProcessingStage.h"
 
 
 
@@ -33,7 +39,8 @@ namespace oscv
 {
 
 /**
- * @brief The ImagePlayer class Player for images, not relying on VideoCapture.
+ * @brief The ImagePlayer class Player for images, not relying on VideoCapture. Qt adapter of
+ *        ImageSequenceDecoder, which indexes, reads ahead and decodes the files.
  */
 
 class ImagePlayer : public QThread, public IPlayer
@@ -41,6 +48,11 @@ class ImagePlayer : public QThread, public IPlayer
     Q_OBJECT
 
 public:
+    /**
+     * @brief DEFAULT_FOLLOW_LAG Number of frames the playback stays behind the writer in follow mode
+     */
+    static const int DEFAULT_FOLLOW_LAG = 2;
+
     ImagePlayer(QObject *parent = 0);
 
     ~ImagePlayer();
@@ -69,6 +81,80 @@ public:
 
     inline void setSpeed(Speed speed);
 
+    /**
+     * @brief setStabilization emit frames warped towards a smoothed camera path while playing.
+     *        @see FrameStabilizer. Frames emitted by open() and go() are not warped.
+     * @param enable
+     */
+    void setStabilization(bool enable);
+
+    inline bool isStabilized() const;
+
+    inline FrameStabilizer& stabilizer();
+
+    /**
+     * @brief setChangeGate emit only frames which differ from the last emitted one while playing,
+     *        the playback timing stays the same. Suppressed frames count as PlayerMetrics::Skipped.
+     *        @see ChangeGate. Frames emitted by open() and go() always pass.
+     * @param enable
+     */
+    void setChangeGate(bool enable);
+
+    inline bool isChangeGated() const;
+
+    inline ChangeGate& changeGate();
+
+    /**
+     * @brief setProcessingStage run a filter on several frames at the same time before they are
+     *        emitted, @see VideoPlayer::setProcessingStage()
+     * @param stage not owned, must outlive the player. Null emits the decoded frames.
+     */
+    void setProcessingStage(ProcessingStage* stage);
+
+    inline ProcessingStage* processingStage() const;
+
+    /**
+     * @brief setFollowMode play a sequence which is still being written. New files are added to the
+     *        sequence as they appear (@see SequenceWatcher) and play() waits at the end of the sequence
+     *        for new frames instead of stopping, until stop() or close() is called.
+     * @param follow true to follow the sequence, false to play only the frames indexed at open()
+     * @param lagFrames number of frames the playback stays behind the last written frame
+     * @return false if following is not supported on this platform or the directory cannot be watched.
+     */
+    bool setFollowMode(bool follow, int lagFrames=DEFAULT_FOLLOW_LAG);
+
+    inline bool isFollowing() const;
+
+    /**
+     * @brief setReadAhead number of files read in the background ahead of the playback, the
+     *        frames are decoded from memory then (@see AsyncFileReader). Raise it for network or
+     *        spinning storage, 0 reads each frame with cv::imread.
+     * @param frames default AsyncFileReader::DEFAULT_QUEUE_DEPTH
+     */
+    void setReadAhead(int frames);
+
+    inline int readAhead() const;
+
+    /**
+     * @brief setPriority executor priority class of the read ahead and the decoding, e.g. Low for a preview
+     *        player next to the main one. @see Executor
+     */
+    inline void setPriority(Executor::Priority priority);
+
+    /**
+     * @brief setReadFlags cv::imread flags, by default 16 bit and float files keep their depth and
+     *        newFrame() carries them as they are. @see ImageSequenceDecoder::setReadFlags(),
+     *        ImageUtils::MatToQImage() and ToneMapper for the display.
+     * @param flags
+     */
+    void setReadFlags(int flags);
+
+    /**
+     * @brief metrics time per stage of the playback loop and frame counters, @see PlayerMetrics.
+     *        Set a report interval to get metricsUpdated() while playing.
+     */
+    inline PlayerMetrics& metrics();
+
 
 protected:
 
@@ -80,6 +166,18 @@ signals:
 
    void donePlay(bool done);
 
+   //! Emitted from the player thread every PlayerMetrics::reportInterval() ms while playing
+   void metricsUpdated(const oscv::PlayerMetrics::Snapshot& snapshot);
+
+
+private slots:
+
+   //! A new file of the sequence has been written, called from the watcher thread
+   void addFrame(int number);
+
+   //! Watcher events were lost, read the directory again
+   void reindex();
+
 
 private:
 
@@ -87,21 +185,38 @@ private:
 
    bool readFrame();
 
+   //! Read the frame m_frameNumber while playing in a task on the executor, m_mutex is locked
+   bool decodeFrame();
+
+   void updateIndex();
+
+   void emitSingleFrame();
+
+   void emitProcessed(ProcessingStage* stage, bool drain);
 
    bool m_stop;
    cv::Mat m_frame;
    QImage m_img;
    QString m_name; // current image name with full path..
-   QString m_filepath;
-   QString m_prefix;
-   QString m_fileExt;
+   ImageSequenceDecoder m_decoder;
    int m_frameRate;
-   int m_frameNumber;
+   int m_frameNumber; // position in the sequence
    int m_totalFrames;
    Speed m_speed;
    QMutex m_mutex;
    QWaitCondition m_waitCondition;
    QVariant m_variant;
+   bool m_stabilize;
+   FrameStabilizer m_stabilizer;
+   cv::Mat m_stabilized;
+   bool m_gated;
+   ChangeGate m_changeGate;
+   bool m_follow;
+   int m_followLag;
+   SequenceWatcher m_watcher;
+   PlayerMetrics m_metrics;
+   ProcessingStage* m_stage; // optional filter between decoding and emitting, not owned
+   TaskGroup m_decodeTasks;  // the decoding while playing, the player thread only paces the frames
 
 
 };
@@ -116,7 +231,9 @@ bool ImagePlayer::isStopped() const
 
 void ImagePlayer::stop(bool stop)
 {
+    QMutexLocker locker(&m_mutex);
     m_stop = stop;
+    m_waitCondition.wakeAll(); // a following player may wait for new frames
 }
 
 QString  ImagePlayer::name() const
@@ -127,7 +244,7 @@ QString  ImagePlayer::name() const
 bool ImagePlayer::setCurrentFrame( int frameNumber)
 {
     QMutexLocker locker(&m_mutex);
-    if ( frameNumber <= VideoDefs::INVALID_FRAME_NUMBER || frameNumber > m_totalFrames ) {
+    if ( frameNumber <= VideoDefs::INVALID_FRAME_NUMBER || frameNumber >= m_totalFrames ) {
         return false;
     }
     m_frameNumber = frameNumber;
@@ -156,6 +273,52 @@ void ImagePlayer::setSpeed(Speed speed)
 
 }
 
+bool ImagePlayer::isStabilized() const
+{
+    return m_stabilize;
+}
+
+FrameStabilizer& ImagePlayer::stabilizer()
+{
+    return m_stabilizer;
+}
+
+bool ImagePlayer::isChangeGated() const
+{
+    return m_gated;
+}
+
+ChangeGate& ImagePlayer::changeGate()
+{
+    return m_changeGate;
+}
+
+bool ImagePlayer::isFollowing() const
+{
+    return m_follow;
+}
+
+int ImagePlayer::readAhead() const
+{
+    return m_decoder.readAhead();
+}
+
+void ImagePlayer::setPriority(Executor::Priority priority)
+{
+    m_decoder.setPriority(priority);
+    m_decodeTasks.setPriority(priority);
+}
+
+ProcessingStage* ImagePlayer::processingStage() const
+{
+    return m_stage;
+}
+
+PlayerMetrics& ImagePlayer::metrics()
+{
+    return m_metrics;
+}
+
 
 }
 #endif // IMAGEPLAYER_H
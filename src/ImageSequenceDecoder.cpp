@@ -0,0 +1,199 @@
+#include "ImageSequenceDecoder.h"
+
+// Qt
+#include <QFileInfo>
+#include <QFile>
+
+// oscv
+#include "VideoDefs.h"
+#include "Tracer.h"
+#include "RawFrame.h"
+#include "OcvUtils.h"
+
+// cv
+#ifdef OPENCV_3
+#include <opencv2/highgui.hpp> //imdecode
+#else
+#include <opencv2/highgui/highgui.hpp>
+#endif
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+ImageSequenceDecoder::ImageSequenceDecoder()
+    : m_position(0)
+    , m_readAhead(AsyncFileReader::DEFAULT_QUEUE_DEPTH)
+    , m_readFlags(cv::IMREAD_COLOR | cv::IMREAD_ANYDEPTH)
+    , m_cached(false)
+    , m_reader(AsyncFileReader::DEFAULT_QUEUE_DEPTH)
+{
+}
+
+bool ImageSequenceDecoder::open(const QString& filename)
+{
+    close();
+    if ( filename.isEmpty() || ! m_index.open(filename) ) {
+        m_index.clear();
+        return false;
+    }
+    QString prefix, ext;
+    int number, digits;
+    SequenceIndex::parseName(QFileInfo(filename).fileName(), prefix, number, digits, ext);
+    m_position = std::max(0, m_index.indexOf(number));
+    m_name = filename;
+    return true;
+}
+
+void ImageSequenceDecoder::close()
+{
+    m_reader.cancel();
+    m_index.clear();
+    m_position = 0;
+    m_name.clear();
+    m_cached = false;
+}
+
+bool ImageSequenceDecoder::read(cv::Mat& frame)
+{
+    if ( m_position < 0 || m_position >= m_index.size() ) {
+        return false;
+    }
+    m_name = m_index.path(m_position);
+    int number = m_index.number(m_position);
+    m_cached = m_readAhead > 0 && m_reader.isPending(number);
+    // decode into the buffer of frame, unless another Mat still refers to it, e.g. an emitted frame
+    if ( OcvUtils::isShared(frame) ) {
+        frame.release();
+    }
+    if ( m_cached )
+    {
+        VIDEN_TRACE_SCOPE("read_ahead_take");
+        bool ok = m_reader.take(number, m_encoded) && decode(m_encoded, frame);
+        m_reader.recycle(m_encoded);
+        if ( ! ok ) {
+            frame.release();
+        }
+    }
+    else
+    {
+        VIDEN_TRACE_INSTANT("read_ahead_miss");
+        m_reader.cancel(); // the position jumped, the requested files are not needed anymore
+        if ( isRaw(m_name) ) {
+            RawFrame::read(m_name, frame); // from the mapped file straight into frame, releases it on failure
+        }
+        else if ( ! readFile(m_name, m_fileData) || ! decode(m_fileData, frame) ) {
+            frame.release();
+        }
+    }
+    m_position++;
+    if ( m_readAhead > 0 ) {
+        requestReadAhead();
+    }
+    return frame.data != NULL;
+}
+
+// Read a whole file into data, which keeps its capacity from frame to frame
+bool ImageSequenceDecoder::readFile(const QString& filename, AsyncFileReader::Buffer& data)
+{
+    QFile file(filename);
+    if ( ! file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    data.resize(static_cast<size_t>(file.size()));
+    return ! data.empty() && file.read(reinterpret_cast<char*>(data.data()), file.size()) == file.size();
+}
+
+bool ImageSequenceDecoder::isRaw(const QString& filename)
+{
+    return filename.endsWith(RawFrame::FILE_EXTENSION, Qt::CaseInsensitive);
+}
+
+bool ImageSequenceDecoder::decode(const AsyncFileReader::Buffer& data, cv::Mat& frame) const
+{
+    if ( data.empty() ) {
+        return false;
+    }
+    // .vraw frames are stored as they are, the read flags do not apply
+    if ( isRaw(m_name) ) {
+        return RawFrame::decode(data.data(), data.size(), frame);
+    }
+    cv::Mat encoded(1, static_cast<int>(data.size()), CV_8UC1, const_cast<unsigned char*>(data.data()));
+    return cv::imdecode(encoded, m_readFlags, &frame).data != NULL; // reuses frame if size and type fit
+}
+
+bool ImageSequenceDecoder::grab()
+{
+    if ( m_position >= m_index.size() ) {
+        return false;
+    }
+    m_position++;
+    return true;
+}
+
+bool ImageSequenceDecoder::seek(int frameNumber)
+{
+    if ( frameNumber <= VideoDefs::INVALID_FRAME_NUMBER || frameNumber >= m_index.size() ) {
+        return false;
+    }
+    m_position = frameNumber;
+    return true;
+}
+
+double ImageSequenceDecoder::frameRate() const
+{
+    return VideoDefs::DEFAULT_FRAME_RATE;
+}
+
+int ImageSequenceDecoder::insert(int number)
+{
+    int pos = m_index.insert(number);
+    if ( pos != VideoDefs::INVALID_FRAME_NUMBER && pos < m_position ) {
+        m_position++;
+    }
+    return pos;
+}
+
+int ImageSequenceDecoder::reindex(int frameNumber)
+{
+    if ( m_index.isEmpty() ) {
+        return VideoDefs::INVALID_FRAME_NUMBER;
+    }
+    int number = m_index.number( std::min(std::max(frameNumber, 0), m_index.size()-1) );
+    bool atEnd = m_position >= m_index.size();
+    int next = m_index.number( std::min(std::max(m_position, 0), m_index.size()-1) );
+    if ( ! m_index.rescan() ) {
+        return VideoDefs::INVALID_FRAME_NUMBER;
+    }
+    m_position = std::max(0, m_index.indexOf(next)) + (atEnd ? 1 : 0);
+    return m_index.indexOf(number);
+}
+
+void ImageSequenceDecoder::setReadAhead(int frames)
+{
+    m_readAhead = std::max(0, frames);
+    if ( m_readAhead > 0 ) {
+        m_reader.setQueueDepth(m_readAhead);
+    }
+    else {
+        m_reader.cancel();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ImageSequenceDecoder::requestReadAhead()
+{
+    int last = std::min(m_position - 1 + m_readAhead, m_index.size()-1);
+    for ( int i=m_position; i<=last; ++i ) {
+        int number = m_index.number(i);
+        if ( ! m_reader.isPending(number) && ! m_reader.request(number, m_index.path(i)) ) {
+            break; // queue is full
+        }
+    }
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,174 @@
+#ifndef IMAGESEQUENCEDECODER_H
+#define IMAGESEQUENCEDECODER_H
+
+/** ***********************************************************************************************
+ * @file ImageSequenceDecoder.h
+ * @brief Frames of an image sequence, read ahead in the background and decoded from memory.
+ */
+
+// oscv
+#include "Decoder.h"
+#include "SequenceIndex.h"
+#include "AsyncFileReader.h"
+
+
+namespace oscv
+{
+
+/**
+ * @brief The ImageSequenceDecoder class IDecoder for image sequences, @see SequenceIndex.
+ *
+ *        The frame number is the position in the sequence, gaps in the file numbers are skipped.
+ *        While reading forward the next readAhead() files are requested from an AsyncFileReader,
+ *        a jump drops the outstanding requests. Without read ahead .vraw files are mapped and
+ *        decoded from the mapping, other files are read into a buffer which is kept.
+ */
+class ImageSequenceDecoder : public IDecoder
+{
+public:
+    ImageSequenceDecoder();
+
+    /**
+     * @brief open index the sequence of the given file, the next read() returns this file
+     */
+    bool open(const QString& filename);
+
+    void close();
+
+    inline bool isOpen() const;
+
+    /**
+     * @brief read decode the next file, into the buffer of frame if it has the right size and type and
+     *        no other Mat refers to it
+     */
+    bool read(cv::Mat& frame);
+
+    bool grab();
+
+    bool seek(int frameNumber);
+
+    inline int position() const;
+
+    inline int frameCount() const;
+
+    double frameRate() const;
+
+    inline QString name() const;
+
+    inline const SequenceIndex& index() const;
+
+    /**
+     * @brief insert add a file which has been written after open(), @see SequenceIndex::insert()
+     * @param number number in the file name
+     * @return position of the file or VideoDefs::INVALID_FRAME_NUMBER if it is already indexed.
+     *         Positions behind it move by one, position() follows the frame it pointed to.
+     */
+    int insert(int number);
+
+    /**
+     * @brief reindex read the directory again, e.g. after file events were lost
+     * @param frameNumber a position in the old index
+     * @return position of the same file in the new index, VideoDefs::INVALID_FRAME_NUMBER if it is gone
+     */
+    int reindex(int frameNumber);
+
+    /**
+     * @brief setReadAhead number of files read in the background ahead of the position
+     * @param frames 0 reads each frame on the calling thread
+     */
+    void setReadAhead(int frames);
+
+    inline int readAhead() const;
+
+    //! Executor priority class of the read ahead, @see AsyncFileReader::setPriority()
+    inline void setPriority(Executor::Priority priority);
+
+    //! True if the last read() took the file from the read ahead
+    inline bool lastReadCached() const;
+
+    /**
+     * @brief setReadFlags cv::imread flags of the frames. The default IMREAD_COLOR | IMREAD_ANYDEPTH
+     *        keeps 16 bit and float files, e.g. thermal TIFF, IMREAD_ANYDEPTH alone also keeps them grey.
+     *        @see ToneMapper to display them.
+     * @param flags
+     */
+    inline void setReadFlags(int flags);
+
+    inline int readFlags() const;
+
+private:
+    void requestReadAhead();
+
+    static bool readFile(const QString& filename, AsyncFileReader::Buffer& data);
+
+    //! True for .vraw files, @see RawFrame
+    static bool isRaw(const QString& filename);
+
+    //! Decode an encoded file of the sequence, m_name is its name
+    bool decode(const AsyncFileReader::Buffer& data, cv::Mat& frame) const;
+
+    SequenceIndex m_index;
+    int m_position;        // next frame to read
+    QString m_name;        // file of the last read frame
+    int m_readAhead;
+    int m_readFlags;
+    bool m_cached;
+    AsyncFileReader m_reader;   // keyed by the file number, positions move when files are inserted
+    AsyncFileReader::Buffer m_encoded;
+    AsyncFileReader::Buffer m_fileData;   // file read without the read ahead, not .vraw
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool ImageSequenceDecoder::isOpen() const
+{
+    return ! m_index.isEmpty();
+}
+
+int ImageSequenceDecoder::position() const
+{
+    return m_position;
+}
+
+int ImageSequenceDecoder::frameCount() const
+{
+    return m_index.size();
+}
+
+QString ImageSequenceDecoder::name() const
+{
+    return m_name;
+}
+
+const SequenceIndex& ImageSequenceDecoder::index() const
+{
+    return m_index;
+}
+
+int ImageSequenceDecoder::readAhead() const
+{
+    return m_readAhead;
+}
+
+void ImageSequenceDecoder::setPriority(Executor::Priority priority)
+{
+    m_reader.setPriority(priority);
+}
+
+bool ImageSequenceDecoder::lastReadCached() const
+{
+    return m_cached;
+}
+
+void ImageSequenceDecoder::setReadFlags(int flags)
+{
+    m_readFlags = flags;
+}
+
+int ImageSequenceDecoder::readFlags() const
+{
+    return m_readFlags;
+}
+
+}
+#endif // IMAGESEQUENCEDECODER_H
@@ -0,0 +1,119 @@
+#include "ImageUtils.h"
+
+// oscv
+#include "ImageWriter.h"
+
+using namespace oscv;
+
+
+void ImageUtils::MatToQImage( const cv::Mat& frame, QImage& qImg)
+{
+    ToneMapper mapper; // measures the range of this frame only
+    MatToQImage(frame, qImg, mapper);
+}
+
+void ImageUtils::MatToQImage( const cv::Mat& frame, QImage& qImg, ToneMapper& mapper)
+{
+    if ( frame.empty() ) {
+        qImg = QImage();
+        return;
+    }
+    cv::Mat src = frame;
+    if ( ToneMapper::isNeeded(frame) ) {
+        mapper.map(frame, src);
+    }
+
+    QImage::Format format;
+    switch ( src.channels() )
+    {
+    case 1:  format = QImage::Format_Grayscale8; break;
+    case 3:  format = QImage::Format_RGB888; break;
+    case 4:  format = QImage::Format_ARGB32; break; // BGRA in memory on little endian
+    default: qImg = QImage(); return;
+    }
+    // reuse the pixels of qImg if it has the right size and format and is not shared
+    if ( qImg.width() != src.cols || qImg.height() != src.rows || qImg.format() != format ) {
+        qImg = QImage(src.cols, src.rows, format);
+    }
+    // convert straight into the image memory, without an intermediate Mat
+    cv::Mat dst(src.rows, src.cols, src.type(), qImg.bits(), qImg.bytesPerLine());
+    if ( src.channels() == 3 ) {
+        cv::cvtColor(src, dst, cv::COLOR_BGR2RGB);
+    }
+    else {
+        src.copyTo(dst);
+    }
+}
+
+QImage ImageUtils::toQImage(const cv::Mat& frame)
+{
+    QImage img;
+    MatToQImage(frame, img);
+    return img;
+}
+
+void ImageUtils::QImageToMat( const QImage& img, cv::Mat frame)
+{
+    cv::Mat converted = toMat(img);
+    // frame is a copy of the caller's header, only the pixels of a matching frame can be written
+    if ( frame.size() == converted.size() && frame.type() == converted.type() ) {
+        converted.copyTo(frame);
+    }
+}
+
+cv::Mat ImageUtils::toMat( const QImage& img)
+{
+    cv::Mat mat;
+    if ( img.isNull() ) {
+        return mat;
+    }
+    switch ( img.format() )
+    {
+    case QImage::Format_RGB888:
+    {
+        cv::Mat src(img.height(), img.width(), CV_8UC3, const_cast<uchar*>(img.constBits()), img.bytesPerLine());
+        cv::cvtColor(src, mat, cv::COLOR_RGB2BGR);
+        break;
+    }
+    case QImage::Format_Grayscale8:
+    {
+        cv::Mat src(img.height(), img.width(), CV_8UC1, const_cast<uchar*>(img.constBits()), img.bytesPerLine());
+        src.copyTo(mat);
+        break;
+    }
+    case QImage::Format_Indexed8:
+        if ( img.isGrayscale() ) {
+            mat = toMat( img.convertToFormat(QImage::Format_Grayscale8) );
+        }
+        else {
+            mat = toMat( img.convertToFormat(QImage::Format_RGB888) );
+        }
+        break;
+    case QImage::Format_RGB32:
+    {
+        cv::Mat src(img.height(), img.width(), CV_8UC4, const_cast<uchar*>(img.constBits()), img.bytesPerLine());
+        cv::cvtColor(src, mat, cv::COLOR_BGRA2BGR);
+        break;
+    }
+    case QImage::Format_ARGB32:
+    {
+        cv::Mat src(img.height(), img.width(), CV_8UC4, const_cast<uchar*>(img.constBits()), img.bytesPerLine());
+        src.copyTo(mat);
+        break;
+    }
+    default:
+        mat = toMat( img.convertToFormat(img.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB888) );
+        break;
+    }
+    return mat;
+}
+
+bool ImageUtils::write( const QString& filename, const cv::Mat& img, IMG_COMPRESSION compression)
+{
+    ImageWriter::Preset preset = compression == IMG_COMPRESSION::JPG ? ImageWriter::Preset::Jpeg
+                                                                     : ImageWriter::Preset::Png;
+    return ImageWriter::writeNow(filename, img, preset);
+}
+
+
+////////////////////////////////// END OF FILE /////////////////////////////////
@@ -8,6 +8,9 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+// oscv
+#include "ToneMapper.h"
+
 
 namespace oscv
 {
@@ -23,13 +26,24 @@ namespace oscv
         /**
          * @brief MatToQImage convert OpenCV image to QImage
          *
-         * This is only for the conversion of RGB 3 channels (RGB888) and gray (Indexed8) image only.
-         * Since we don't use 4 channels, otherwise, this must be added in the function.
+         * Gray (Grayscale8), BGR (RGB888) and BGRA (ARGB32) images are converted. Images of other
+         * depths than 8 bit, e.g. 16 bit thermal frames, are stretched to 8 bit by their own
+         * percentile range (@see ToneMapper).
          * @param frame image in OpenCV as input
          * @param qImg QImage as output
          */
 
       static  void MatToQImage( const cv::Mat& frame, QImage& qImg);
+
+      /**
+       * @brief MatToQImage convert frame after frame of a player, images of other depths than 8 bit
+       *        are mapped with the range the mapper adapts over the frames, without flicker and
+       *        without a histogram per frame.
+       * @param frame
+       * @param qImg
+       * @param mapper kept by the caller from frame to frame
+       */
+      static  void MatToQImage( const cv::Mat& frame, QImage& qImg, ToneMapper& mapper);
       static QImage toQImage(const cv::Mat& frame);
 
 
@@ -63,11 +77,12 @@ namespace oscv
       static cv::Mat calHistogram( const cv::Mat& img );
 
       /**
-       * @brief write
+       * @brief write encode and write on the calling thread, PNG with the fast ImageWriter::Preset::Png,
+       *        JPG with quality 95. Use an ImageWriter to write from a processing loop.
        * @param complete filename full path with filename and its extension
        * @param img
        * @param compression compression type should corresponding to given filename
-       * @return
+       * @return false if the file cannot be written
        */
       static bool write( const QString& filename, const cv::Mat& img, IMG_COMPRESSION compression);
 
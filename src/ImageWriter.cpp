@@ -0,0 +1,217 @@
+#include "ImageWriter.h"
+
+// oscv
+#include "Tracer.h"
+#include "RawFrame.h"
+
+// cv
+#ifdef OPENCV_3
+#include <opencv2/highgui.hpp> //imwrite
+#else
+#include <opencv2/highgui/highgui.hpp>
+#endif
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+ImageWriter::ImageWriter(int maxQueued)
+    : m_maxQueued(1)
+    , m_overflow(Overflow::Block)
+    , m_nextTicket(0)
+    , m_written(0)
+    , m_dropped(0)
+    , m_failedSinceFlush(0)
+    , m_tasks(Executor::instance(), Executor::Priority::Low)
+{
+    setMaxQueued(maxQueued);
+}
+
+ImageWriter::~ImageWriter()
+{
+    m_tasks.wait();
+}
+
+bool ImageWriter::write(const QString& filename, const cv::Mat& img, Preset preset)
+{
+    if ( img.empty() ) {
+        return false;
+    }
+    quint64 ticket;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if ( static_cast<int>(m_pending.size()) >= m_maxQueued )
+        {
+            if ( m_overflow == Overflow::Drop ) {
+                m_dropped++;
+                return false;
+            }
+            VIDEN_TRACE_SCOPE("write_queue_full");
+            Executor::instance().waitUntil(lock, m_done, [this]{
+                return static_cast<int>(m_pending.size()) < m_maxQueued;
+            });
+        }
+        ticket = ++m_nextTicket;
+        m_pending.insert(ticket);
+    }
+
+    cv::Mat image = img.clone();
+    m_tasks.run([this, ticket, filename, image, preset]
+    {
+        QString message;
+        bool ok = writeNow(filename, image, preset, &message);
+        finish(ticket, filename, ok, message);
+    });
+    return true;
+}
+
+quint64 ImageWriter::fence() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nextTicket;
+}
+
+void ImageWriter::wait(quint64 fence)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Executor::instance().waitUntil(lock, m_done, [this, fence]{
+        return m_pending.empty() || *m_pending.begin() > fence;
+    });
+}
+
+bool ImageWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Executor::instance().waitUntil(lock, m_done, [this]{ return m_pending.empty(); });
+    bool ok = m_failedSinceFlush == 0;
+    m_failedSinceFlush = 0;
+    return ok;
+}
+
+int ImageWriter::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<int>(m_pending.size());
+}
+
+void ImageWriter::setMaxQueued(int images)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxQueued = images > 0 ? images : 2*Executor::instance().threadCount();
+    m_done.notify_all();
+}
+
+void ImageWriter::setErrorHandler(const ErrorHandler& handler)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_errorHandler = handler;
+}
+
+std::vector<ImageWriter::Error> ImageWriter::takeErrors()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Error> errors;
+    errors.swap(m_errors);
+    return errors;
+}
+
+std::vector<int> ImageWriter::params(Preset preset)
+{
+    std::vector<int> p;
+    switch ( preset )
+    {
+    case Preset::Png:
+        p.push_back(cv::IMWRITE_PNG_COMPRESSION);
+        p.push_back(1);
+        break;
+    case Preset::PngSmall:
+        p.push_back(cv::IMWRITE_PNG_COMPRESSION);
+        p.push_back(9);
+        break;
+    case Preset::Jpeg:
+        p.push_back(cv::IMWRITE_JPEG_QUALITY);
+        p.push_back(95);
+        break;
+    case Preset::JpegFast:
+        p.push_back(cv::IMWRITE_JPEG_QUALITY);
+        p.push_back(80);
+        break;
+    case Preset::Raw:
+        p.push_back(cv::IMWRITE_PXM_BINARY);
+        p.push_back(1);
+        break;
+    }
+    return p;
+}
+
+QString ImageWriter::extension(Preset preset, int channels)
+{
+    switch ( preset )
+    {
+    case Preset::Png:
+    case Preset::PngSmall:
+        return ".png";
+    case Preset::Jpeg:
+    case Preset::JpegFast:
+        return ".jpg";
+    case Preset::Raw:
+        return channels == 1 ? ".pgm" : ".ppm";
+    }
+    return QString();
+}
+
+bool ImageWriter::writeNow(const QString& filename, const cv::Mat& img, Preset preset, QString* message)
+{
+    VIDEN_TRACE_SCOPE("imwrite");
+    QString error;
+    bool ok = false;
+    try {
+        if ( filename.endsWith(RawFrame::FILE_EXTENSION, Qt::CaseInsensitive) ) {
+            ok = RawFrame::write(filename, img);
+        }
+        else {
+            ok = cv::imwrite(filename.toStdString(), img, params(preset));
+        }
+        if ( ! ok ) {
+            error = "the file cannot be written or the format is not supported";
+        }
+    }
+    catch ( const cv::Exception& e ) {
+        error = QString::fromLocal8Bit(e.what());
+    }
+    if ( message ) {
+        *message = error;
+    }
+    return ok;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ImageWriter::finish(quint64 ticket, const QString& filename, bool ok, const QString& message)
+{
+    ErrorHandler handler;
+    Error error;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.erase(ticket);
+        if ( ok ) {
+            m_written++;
+        }
+        else {
+            error.filename = filename;
+            error.message = message;
+            m_errors.push_back(error);
+            m_failedSinceFlush++;
+            handler = m_errorHandler;
+        }
+        m_done.notify_all();
+    }
+    if ( handler ) {
+        handler(error);
+    }
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,185 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+/** ***********************************************************************************************
+ * @file ImageWriter.h
+ * @brief Asynchronous image file writer with a bounded queue and compression presets.
+ */
+
+// Qt
+#include <QString>
+
+// oscv
+#include "Executor.h"
+
+// cv
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <set>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The ImageWriter class encodes and writes images on the Executor, so a processing loop does
+ *        not wait for the encoder or the disk.
+ *
+ *        write() copies the image and returns, at most maxQueued() images are queued or being
+ *        encoded. When the queue is full write() blocks until a slot is free, or fails with the
+ *        Overflow::Drop policy. fence() marks the writes issued so far, wait() returns when they
+ *        are on disk:
+ *        @code
+ *        ImageWriter writer;
+ *        writer.write(dir + "mask_0001.png", mask, ImageWriter::Preset::Png);
+ *        quint64 f = writer.fence();
+ *        ...                       // keep processing
+ *        writer.wait(f);           // e.g. before the next stage reads the files
+ *        if ( ! writer.flush() ) { // waits for all, false if a write failed since the last flush
+ *            foreach error in writer.takeErrors() ...
+ *        }
+ *        @endcode
+ *        Failed writes are collected (takeErrors()) and passed to the error handler, which is called
+ *        on an executor thread. All functions can be called from any thread.
+ */
+class ImageWriter
+{
+public:
+    enum class Preset
+    {
+        Png = 0,   //!< PNG compression level 1, lossless and fast
+        PngSmall,  //!< PNG compression level 9, for archives
+        Jpeg,      //!< JPEG quality 95
+        JpegFast,  //!< JPEG quality 80, small files for previews
+        Raw        //!< PPM/PGM, no compression at all, for scratch files. 8 and 16 bit.
+    };
+
+    enum class Overflow { Block = 0, Drop };
+
+    struct Error
+    {
+        QString filename;
+        QString message;
+    };
+
+    typedef std::function<void(const Error& error)> ErrorHandler;
+
+    /**
+     * @brief ImageWriter
+     * @param maxQueued images queued and not yet written, 0 for two per executor thread
+     */
+    explicit ImageWriter(int maxQueued=0);
+
+    //! Waits for the queued images
+    ~ImageWriter();
+
+    /**
+     * @brief write queue an image
+     * @param filename the extension should fit the preset, @see extension()
+     * @param img the caller may overwrite it afterwards
+     * @param preset
+     * @return false if the queue is full and the overflow policy is Drop, or img is empty
+     */
+    bool write(const QString& filename, const cv::Mat& img, Preset preset=Preset::Png);
+
+    //! Ticket of the writes issued so far, @see wait()
+    quint64 fence() const;
+
+    //! Wait until all writes issued before the fence have finished
+    void wait(quint64 fence);
+
+    /**
+     * @brief flush wait for all queued images
+     * @return false if a write failed since the last flush()
+     */
+    bool flush();
+
+    int pending() const;
+
+    void setMaxQueued(int images);
+
+    inline int maxQueued() const;
+
+    inline void setOverflow(Overflow overflow);
+
+    //! Executor priority class of the encoders, Low by default
+    inline void setPriority(Executor::Priority priority);
+
+    void setErrorHandler(const ErrorHandler& handler);
+
+    //! The errors since the last call
+    std::vector<Error> takeErrors();
+
+    inline quint64 written() const;
+
+    inline quint64 dropped() const;
+
+    //! cv::imwrite parameters of a preset
+    static std::vector<int> params(Preset preset);
+
+    //! File extension of a preset, Raw gives ".pgm" for 1 channel and ".ppm" otherwise
+    static QString extension(Preset preset, int channels=3);
+
+    /**
+     * @brief writeNow encode and write on the calling thread, a .vraw file name gives an uncompressed
+     *        RawFrame whatever the preset
+     * @param message[out] reason of a failure, may be null
+     */
+    static bool writeNow(const QString& filename, const cv::Mat& img, Preset preset, QString* message=NULL);
+
+private:
+    ImageWriter(const ImageWriter&);
+    ImageWriter& operator=(const ImageWriter&);
+
+    void finish(quint64 ticket, const QString& filename, bool ok, const QString& message);
+
+    int m_maxQueued;
+    Overflow m_overflow;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_done;
+    std::set<quint64> m_pending;    // tickets queued or being written
+    quint64 m_nextTicket;
+    quint64 m_written;
+    quint64 m_dropped;
+    int m_failedSinceFlush;
+    std::vector<Error> m_errors;
+    ErrorHandler m_errorHandler;
+    TaskGroup m_tasks;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+int ImageWriter::maxQueued() const
+{
+    return m_maxQueued;
+}
+
+void ImageWriter::setOverflow(Overflow overflow)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_overflow = overflow;
+}
+
+void ImageWriter::setPriority(Executor::Priority priority)
+{
+    m_tasks.setPriority(priority);
+}
+
+quint64 ImageWriter::written() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
+
+quint64 ImageWriter::dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+}
+#endif // IMAGEWRITER_H
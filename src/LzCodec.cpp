@@ -0,0 +1,190 @@
+#include "LzCodec.h"
+
+#include <vector>
+#include <cstring>
+
+using namespace oscv;
+
+
+namespace
+{
+    const int MIN_MATCH = 4;
+    const int HASH_BITS = 16;
+    const size_t MAX_OFFSET = 65535;
+    // the last bytes are always literals, so the match search can read 4 bytes without a bound check
+    const size_t END_LITERALS = 8;
+
+    inline unsigned int read32(const unsigned char* p)
+    {
+        unsigned int v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline unsigned int hash32(unsigned int v)
+    {
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Length extension of a token nibble: 255, 255, ..., rest
+    inline bool writeLength(size_t length, unsigned char*& op, const unsigned char* end)
+    {
+        for ( ; length >= 255; length -= 255 ) {
+            if ( op >= end ) {
+                return false;
+            }
+            *op++ = 255;
+        }
+        if ( op >= end ) {
+            return false;
+        }
+        *op++ = static_cast<unsigned char>(length);
+        return true;
+    }
+
+    inline bool readLength(size_t& length, const unsigned char*& ip, const unsigned char* end)
+    {
+        unsigned char b;
+        do {
+            if ( ip >= end ) {
+                return false;
+            }
+            b = *ip++;
+            length += b;
+        } while ( b == 255 );
+        return true;
+    }
+
+    // One sequence: token, literals, and a match unless matchLength is 0 (the last sequence)
+    bool writeSequence(const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength,
+                       unsigned char*& op, const unsigned char* end)
+    {
+        if ( op >= end ) {
+            return false;
+        }
+        unsigned char* token = op++;
+        size_t m = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+        *token = static_cast<unsigned char>( ((literalLength < 15 ? literalLength : 15) << 4) | (m < 15 ? m : 15) );
+        if ( literalLength >= 15 && ! writeLength(literalLength - 15, op, end) ) {
+            return false;
+        }
+        if ( static_cast<size_t>(end - op) < literalLength ) {
+            return false;
+        }
+        if ( literalLength > 0 ) {
+            std::memcpy(op, literals, literalLength);
+            op += literalLength;
+        }
+        if ( matchLength == 0 ) {
+            return true;
+        }
+        if ( end - op < 2 ) {
+            return false;
+        }
+        *op++ = static_cast<unsigned char>(offset & 0xFF);
+        *op++ = static_cast<unsigned char>(offset >> 8);
+        return m < 15 || writeLength(m - 15, op, end);
+    }
+}
+
+
+size_t LzCodec::maxCompressedSize(size_t size)
+{
+    return size + size/255 + 16;
+}
+
+size_t LzCodec::compress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity)
+{
+    unsigned char* op = dst;
+    const unsigned char* end = dst + capacity;
+    size_t anchor = 0;
+
+    if ( size > END_LITERALS + MIN_MATCH )
+    {
+        std::vector<unsigned int> table(1 << HASH_BITS, 0); // position + 1, 0 is empty
+        const size_t limit = size - END_LITERALS;
+        size_t ip = 0;
+        while ( ip < limit )
+        {
+            unsigned int seq = read32(src + ip);
+            unsigned int& slot = table[hash32(seq)];
+            size_t ref = slot;
+            slot = static_cast<unsigned int>(ip + 1);
+            if ( ref == 0 || ip + 1 - ref > MAX_OFFSET || read32(src + ref - 1) != seq ) {
+                // skip faster through data which does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            ref -= 1;
+            size_t length = MIN_MATCH;
+            while ( ip + length < limit && src[ref + length] == src[ip + length] ) {
+                ++length;
+            }
+            if ( ! writeSequence(src + anchor, ip - anchor, ip - ref, length, op, end) ) {
+                return 0;
+            }
+            ip += length;
+            anchor = ip;
+        }
+    }
+    if ( ! writeSequence(src + anchor, size - anchor, 0, 0, op, end) ) {
+        return 0;
+    }
+    return static_cast<size_t>(op - dst);
+}
+
+bool LzCodec::decompress(const unsigned char* src, size_t size, unsigned char* dst, size_t rawSize)
+{
+    const unsigned char* ip = src;
+    const unsigned char* const ipEnd = src + size;
+    unsigned char* op = dst;
+    unsigned char* const opEnd = dst + rawSize;
+
+    while ( ip < ipEnd )
+    {
+        unsigned char token = *ip++;
+        size_t literals = token >> 4;
+        if ( literals == 15 && ! readLength(literals, ip, ipEnd) ) {
+            return false;
+        }
+        if ( static_cast<size_t>(ipEnd - ip) < literals || static_cast<size_t>(opEnd - op) < literals ) {
+            return false;
+        }
+        if ( literals > 0 ) {
+            std::memcpy(op, ip, literals);
+            ip += literals;
+            op += literals;
+        }
+        if ( ip == ipEnd ) {
+            break; // the last sequence has no match
+        }
+
+        if ( ipEnd - ip < 2 ) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t length = token & 15;
+        if ( length == 15 && ! readLength(length, ip, ipEnd) ) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if ( offset == 0 || offset > static_cast<size_t>(op - dst) || static_cast<size_t>(opEnd - op) < length ) {
+            return false;
+        }
+        const unsigned char* match = op - offset;
+        if ( offset >= length ) {
+            std::memcpy(op, match, length);
+            op += length;
+        }
+        else {
+            // overlapping, e.g. a run of one repeated byte
+            for ( size_t i=0; i<length; ++i ) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op == opEnd;
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
@@ -0,0 +1,52 @@
+#ifndef LZCODEC_H
+#define LZCODEC_H
+
+/** ***********************************************************************************************
+ * @file LzCodec.h
+ * @brief Small, fast LZ77 block compression for scratch data, no external dependency.
+ */
+
+#include <cstddef>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The LzCodec class compresses a block of bytes with byte aligned LZ77 sequences in the style
+ *        of LZ4: a token with 4 bit literal and match lengths, the literals, a 16 bit offset and
+ *        length extensions in 255 steps. A single hash probe per position keeps the compressor at
+ *        a few hundred MB/s; decompression is mostly memcpy.
+ *
+ *        The ratio is modest, it pays off for masks, synthetic and quantized images, hardly for noisy
+ *        camera frames. The blocks are not compatible with the LZ4 frame format.
+ */
+class LzCodec
+{
+public:
+    //! Size of the destination buffer which compress() needs in the worst case
+    static size_t maxCompressedSize(size_t size);
+
+    /**
+     * @brief compress
+     * @param src
+     * @param size bytes of src
+     * @param dst
+     * @param capacity bytes of dst
+     * @return size of the compressed block, 0 if it does not fit into capacity
+     */
+    static size_t compress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity);
+
+    /**
+     * @brief decompress a block of compress(), every read and write is checked against the bounds
+     * @param src
+     * @param size bytes of the compressed block
+     * @param dst
+     * @param rawSize size of the original data
+     * @return false if the block is corrupt or does not decompress to exactly rawSize bytes
+     */
+    static bool decompress(const unsigned char* src, size_t size, unsigned char* dst, size_t rawSize);
+};
+
+}
+#endif // LZCODEC_H
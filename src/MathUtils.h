@@ -8,6 +8,19 @@ namespace oscv
     {
         return (T > 0) ? 1 : ((T < 0) ? -1 : 0);
     }
+
+    //! Number of set bits, a single popcnt instruction when built with -mpopcnt or -march=native
+    inline int popcount64(unsigned long long val)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(val);
+#else
+        val = val - ((val >> 1) & 0x5555555555555555ULL);
+        val = (val & 0x3333333333333333ULL) + ((val >> 2) & 0x3333333333333333ULL);
+        val = (val + (val >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<int>((val * 0x0101010101010101ULL) >> 56);
+#endif
+    }
 }
 
 
@@ -0,0 +1,228 @@
+#include "MotionDetector.h"
+
+// cv
+#include <opencv2/imgproc/imgproc.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <cstdlib>
+
+using namespace oscv;
+
+
+MotionDetector::MotionDetector(Model model, double scale)
+    : m_model(model)
+    , m_activeModel(model)
+    , m_scale(1.0)
+    , m_activeScale(1.0)
+    , m_threshold(DEFAULT_THRESHOLD)
+    , m_learningShift(DEFAULT_LEARNING_SHIFT)
+    , m_updateInterval(1)
+    , m_frameCount(0)
+    , m_initialized(false)
+{
+    setScale(scale);
+    m_activeScale = m_scale;
+    setOpening(3);
+}
+
+const cv::Mat& MotionDetector::apply(const cv::Mat& frame)
+{
+    if ( frame.empty() ) {
+        return m_mask;
+    }
+    if ( ! m_initialized ) {
+        m_activeModel = m_model;
+        m_activeScale = m_scale;
+    }
+    prepare(frame);
+
+    if ( ! m_initialized || m_gray.size() != m_mask.size() )
+    {
+        if ( m_activeModel == Model::RunningAverage ) {
+            m_gray.convertTo(m_model16, CV_16S, 128.0);
+        }
+        else {
+            m_gray.copyTo(m_background);
+        }
+        m_mask.create(m_gray.size(), CV_8UC1);
+        m_mask.setTo(cv::Scalar(0));
+        m_frameCount = 0;
+        m_initialized = true;
+        return m_mask;
+    }
+
+    if ( m_activeModel == Model::RunningAverage ) {
+        updateRunningAverage();
+    }
+    else {
+        updateApproximateMedian(m_frameCount % m_updateInterval == 0);
+    }
+    m_frameCount++;
+
+    if ( ! m_kernel.empty() ) {
+        cv::morphologyEx(m_mask, m_mask, cv::MORPH_OPEN, m_kernel);
+    }
+    return m_mask;
+}
+
+const cv::Mat& MotionDetector::background()
+{
+    if ( m_initialized && m_activeModel == Model::RunningAverage ) {
+        m_model16.convertTo(m_background, CV_8U, 1.0/128.0);
+    }
+    return m_background;
+}
+
+const Contours& MotionDetector::blobs(int minArea)
+{
+    m_blobs.find(m_mask, minArea, 1.0 / m_activeScale);
+    return m_blobs;
+}
+
+void MotionDetector::reset()
+{
+    m_initialized = false;
+    m_frameCount = 0;
+    m_toneMapper.reset();
+}
+
+void MotionDetector::setOpening(int size)
+{
+    if ( size > 1 ) {
+        m_kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(size, size));
+    }
+    else {
+        m_kernel.release();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MotionDetector::prepare(const cv::Mat& frame)
+{
+    const cv::Mat* src = &frame;
+    if ( m_activeScale < 1.0 ) {
+        cv::resize(frame, m_scaled, cv::Size(), m_activeScale, m_activeScale, cv::INTER_AREA);
+        src = &m_scaled;
+    }
+    // converted into member buffers only, m_gray may share the memory of the caller's frame
+    const bool map = ToneMapper::isNeeded(*src);
+    cv::Mat& converted = map ? m_deep : m_gray8;
+    switch ( src->channels() )
+    {
+    case 3:
+        cv::cvtColor(*src, converted, CV_BGR2GRAY);
+        src = &converted;
+        break;
+    case 4:
+        cv::cvtColor(*src, converted, CV_BGRA2GRAY);
+        src = &converted;
+        break;
+    default:
+        break; // grey already, no copy
+    }
+    if ( map ) {
+        m_toneMapper.map(*src, m_gray8); // the range of the values, not only the high byte
+        src = &m_gray8;
+    }
+    m_gray = *src;
+}
+
+void MotionDetector::updateRunningAverage()
+{
+    // background in 8.7 fixed point: bg += ((frame << 7) - bg) >> shift, the mask compares the frame
+    // with the rounded background before the update
+    const int shift = m_learningShift;
+    const int threshold = m_threshold;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(64);
+    const __m128i minDiff = _mm_set1_epi8(static_cast<char>(threshold + 1));
+    const __m128i shiftv = _mm_cvtsi32_si128(shift);
+#endif
+
+    for ( int y=0; y<m_gray.rows; ++y )
+    {
+        const uchar* g = m_gray.ptr<uchar>(y);
+        short* bg = m_model16.ptr<short>(y);
+        uchar* m = m_mask.ptr<uchar>(y);
+        int x = 0;
+#if defined(__SSE2__)
+        for ( ; x+16<=m_gray.cols; x+=16 )
+        {
+            __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g + x));
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + x));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + x + 8));
+
+            __m128i b8 = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(b0, half), 7),
+                                          _mm_srai_epi16(_mm_add_epi16(b1, half), 7));
+            __m128i d = _mm_or_si128(_mm_subs_epu8(f, b8), _mm_subs_epu8(b8, f));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(m + x), _mm_cmpeq_epi8(_mm_max_epu8(d, minDiff), d));
+
+            __m128i f0 = _mm_slli_epi16(_mm_unpacklo_epi8(f, zero), 7);
+            __m128i f1 = _mm_slli_epi16(_mm_unpackhi_epi8(f, zero), 7);
+            b0 = _mm_add_epi16(b0, _mm_sra_epi16(_mm_sub_epi16(f0, b0), shiftv));
+            b1 = _mm_add_epi16(b1, _mm_sra_epi16(_mm_sub_epi16(f1, b1), shiftv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(bg + x), b0);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(bg + x + 8), b1);
+        }
+#endif
+        for ( ; x<m_gray.cols; ++x )
+        {
+            int b = bg[x];
+            int d = std::abs(g[x] - ((b + 64) >> 7));
+            m[x] = d > threshold ? 255 : 0;
+            bg[x] = static_cast<short>(b + (((g[x] << 7) - b) >> shift));
+        }
+    }
+}
+
+void MotionDetector::updateApproximateMedian(bool learn)
+{
+    // background moves one grey level towards the frame
+    const int threshold = m_threshold;
+
+#if defined(__SSE2__)
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i minDiff = _mm_set1_epi8(static_cast<char>(threshold + 1));
+#endif
+
+    for ( int y=0; y<m_gray.rows; ++y )
+    {
+        const uchar* g = m_gray.ptr<uchar>(y);
+        uchar* bg = m_background.ptr<uchar>(y);
+        uchar* m = m_mask.ptr<uchar>(y);
+        int x = 0;
+#if defined(__SSE2__)
+        for ( ; x+16<=m_gray.cols; x+=16 )
+        {
+            __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g + x));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + x));
+            __m128i up = _mm_subs_epu8(f, b);
+            __m128i down = _mm_subs_epu8(b, f);
+            __m128i d = _mm_or_si128(up, down);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(m + x), _mm_cmpeq_epi8(_mm_max_epu8(d, minDiff), d));
+            if ( learn ) {
+                b = _mm_subs_epu8(_mm_adds_epu8(b, _mm_min_epu8(up, one)), _mm_min_epu8(down, one));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(bg + x), b);
+            }
+        }
+#endif
+        for ( ; x<m_gray.cols; ++x )
+        {
+            int d = g[x] - bg[x];
+            m[x] = std::abs(d) > threshold ? 255 : 0;
+            if ( learn ) {
+                bg[x] = static_cast<uchar>(bg[x] + (d > 0) - (d < 0));
+            }
+        }
+    }
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
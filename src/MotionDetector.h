@@ -0,0 +1,201 @@
+#ifndef MOTIONDETECTOR_H
+#define MOTIONDETECTOR_H
+
+/** ***********************************************************************************************
+ * @file MotionDetector.h
+ * @brief Foreground mask of a stationary camera from a per pixel background model.
+ */
+
+// oscv
+#include "Drawing.h"
+#include "ToneMapper.h"
+
+// cv
+#include <opencv2/core/core.hpp>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The MotionDetector class keeps a background image and marks the pixels of each frame which
+ *        differ from it by more than a threshold.
+ *
+ *        The frames are converted to grey and optionally downscaled, 16 bit and float frames are
+ *        mapped to 8 bit by the range of their values (@see ToneMapper). The model is updated per pixel
+ *        in 8 or 16 bit integers (SSE2 where available, 16 pixels per instruction) and the mask is
+ *        cleaned by a morphological opening. All buffers are members, after the first frame apply()
+ *        does not allocate. blobs() hands the mask to Contours in frame coordinates:
+ *        @code
+ *        MotionDetector detector(MotionDetector::Model::ApproximateMedian, 0.5);
+ *        detector.apply(frame);
+ *        const Contours& blobs = detector.blobs(200);
+ *        @endcode
+ *
+ *        Models:
+ *        - RunningAverage: background += (frame - background) / 2^learningShift, 8.7 fixed point.
+ *          Adapts smoothly, slow objects leave a trail.
+ *        - ApproximateMedian: background moves by one grey level towards the frame per update, which
+ *          converges to the median. Robust against objects passing by, slow to adapt to light changes.
+ */
+class MotionDetector
+{
+public:
+    enum class Model { RunningAverage=0, ApproximateMedian };
+
+    static const int DEFAULT_THRESHOLD = 25;
+    static const int DEFAULT_LEARNING_SHIFT = 5;
+
+    /**
+     * @brief MotionDetector
+     * @param model
+     * @param scale 0 < scale <= 1, the frame is shrunk before processing, 0.5 is four times less work
+     */
+    explicit MotionDetector(Model model=Model::RunningAverage, double scale=1.0);
+
+    /**
+     * @brief apply update the background with the frame and compute its foreground mask.
+     *        The first frame after reset() becomes the background.
+     * @param frame BGR or grey image, the size must stay the same until reset()
+     * @return the mask, see mask()
+     */
+    const cv::Mat& apply(const cv::Mat& frame);
+
+    //! CV_8UC1 mask at the processing scale, 255 for foreground. Overwritten by the next apply().
+    inline const cv::Mat& mask() const;
+
+    //! Background at the processing scale, CV_8UC1
+    const cv::Mat& background();
+
+    /**
+     * @brief blobs contours of the foreground mask in frame coordinates, reused from call to call
+     * @param minArea min number of frame pixels of a blob
+     */
+    const Contours& blobs(int minArea=10);
+
+    //! Forget the background, the next frame starts a new one
+    void reset();
+
+    /**
+     * @brief setThreshold difference of grey levels above which a pixel is foreground
+     * @param threshold 0..254
+     */
+    inline void setThreshold(int threshold);
+
+    inline int threshold() const;
+
+    /**
+     * @brief setLearningShift speed of the RunningAverage model, each frame moves the background by
+     *        1/2^shift towards the frame. 5 (1/32) adapts within about a second at 25 fps.
+     * @param shift 0..7
+     */
+    inline void setLearningShift(int shift);
+
+    inline int learningShift() const;
+
+    /**
+     * @brief setUpdateInterval update the ApproximateMedian model every n-th frame only, slows it down
+     * @param frames at least 1
+     */
+    inline void setUpdateInterval(int frames);
+
+    /**
+     * @brief setOpening size of the morphological opening which removes noise from the mask
+     * @param size 0 or 1 disables it
+     */
+    void setOpening(int size);
+
+    //! Changes take effect with a reset()
+    inline void setModel(Model model);
+
+    inline Model model() const;
+
+    //! Changes take effect with a reset()
+    inline void setScale(double scale);
+
+    inline double scale() const;
+
+private:
+    //! Grey, scaled frame into m_gray
+    void prepare(const cv::Mat& frame);
+
+    void updateRunningAverage();
+
+    void updateApproximateMedian(bool learn);
+
+    Model m_model;
+    Model m_activeModel;   // model of the current background
+    double m_scale;
+    double m_activeScale;
+    int m_threshold;
+    int m_learningShift;
+    int m_updateInterval;
+    int m_frameCount;
+    bool m_initialized;
+
+    cv::Mat m_scaled;      // frame at the processing scale
+    cv::Mat m_deep;        // grey frame of 16 bit or float, before the tone mapping
+    cv::Mat m_gray8;       // CV_8UC1, the converted frame
+    cv::Mat m_gray;        // CV_8UC1, m_gray8 or the frame itself, only read
+    cv::Mat m_model16;     // RunningAverage background, CV_16SC1 in 8.7 fixed point
+    cv::Mat m_background;  // CV_8UC1, the ApproximateMedian model or m_model16 converted by background()
+    cv::Mat m_mask;
+    cv::Mat m_kernel;
+    Contours m_blobs;
+    ToneMapper m_toneMapper;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+const cv::Mat& MotionDetector::mask() const
+{
+    return m_mask;
+}
+
+void MotionDetector::setThreshold(int threshold)
+{
+    m_threshold = std::min(std::max(threshold, 0), 254);
+}
+
+int MotionDetector::threshold() const
+{
+    return m_threshold;
+}
+
+void MotionDetector::setLearningShift(int shift)
+{
+    m_learningShift = std::min(std::max(shift, 0), 7);
+}
+
+int MotionDetector::learningShift() const
+{
+    return m_learningShift;
+}
+
+void MotionDetector::setUpdateInterval(int frames)
+{
+    m_updateInterval = std::max(1, frames);
+}
+
+void MotionDetector::setModel(Model model)
+{
+    m_model = model;
+}
+
+MotionDetector::Model MotionDetector::model() const
+{
+    return m_model;
+}
+
+void MotionDetector::setScale(double scale)
+{
+    m_scale = scale > 0.0 && scale <= 1.0 ? scale : 1.0;
+}
+
+double MotionDetector::scale() const
+{
+    return m_scale;
+}
+
+}
+#endif // MOTIONDETECTOR_H
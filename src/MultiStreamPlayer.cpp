@@ -0,0 +1,387 @@
+/** ***********************************************************************************************
+ * @file MultiStreamPlayer.cpp
+ * @brief
+ */
+
+
+// Qt
+#include <QElapsedTimer>
+#include <QVariant>
+
+// oscv
+#include "MultiStreamPlayer.h"
+#include "VideoDefs.h"
+#include "TimeUtils.h"
+#include "Tracer.h"
+
+#include <algorithm>
+
+
+using namespace oscv;
+
+
+
+MultiStreamPlayer::MultiStreamPlayer(QObject *parent) :
+    QThread(parent)
+    , m_clockMs(0.0)
+    , m_clockRate(VideoDefs::DEFAULT_FRAME_RATE)
+    , m_stop(true)
+    , m_barrier(false)
+    , m_prefetch(FrameSource::DEFAULT_PREFETCH)
+    , m_priority(Executor::Priority::Normal)
+    , m_speed(Speed::Normal)
+{
+     qRegisterMetaType<cv::Mat>("cv::Mat");
+     qRegisterMetaType<PlayerMetrics::Snapshot>("oscv::PlayerMetrics::Snapshot");
+}
+
+
+MultiStreamPlayer::~MultiStreamPlayer()
+{
+    halt();
+    m_streams.clear();
+}
+
+
+bool MultiStreamPlayer::open(QString filename)
+{
+    close();
+    return addStream(filename) >= 0;
+}
+
+
+int MultiStreamPlayer::addStream(const QString& filename, double offsetMs)
+{
+    halt();
+    std::unique_ptr<Stream> stream(new Stream);
+    stream->source.setPriority(m_priority);
+    if ( ! stream->source.open(filename, m_prefetch) ) {
+        return -1;
+    }
+    stream->name = filename;
+    stream->offsetMs = offsetMs;
+    stream->frameRate = stream->source.frameRate() > 0.0 ? stream->source.frameRate()
+                                                          : VideoDefs::DEFAULT_FRAME_RATE;
+    stream->frameCount = std::max(0, stream->source.frameCount());
+
+    QMutexLocker locker(&m_mutex);
+    m_streams.push_back( std::move(stream) );
+    m_clockRate = 0.0;
+    for ( const std::unique_ptr<Stream>& s : m_streams ) {
+        m_clockRate = std::max(m_clockRate, s->frameRate);
+    }
+    locker.unlock();
+    seekAll(m_clockMs);
+    return streamCount()-1;
+}
+
+
+void MultiStreamPlayer::setOffset(int stream, double offsetMs)
+{
+    if ( stream < 0 || stream >= streamCount() ) {
+        return;
+    }
+    bool running = isRunning();
+    halt();
+    m_streams[stream]->offsetMs = offsetMs;
+    seekAll(m_clockMs);
+    if ( running ) {
+        play();
+    }
+}
+
+
+double MultiStreamPlayer::offset(int stream) const
+{
+    return stream >= 0 && stream < streamCount() ? m_streams[stream]->offsetMs : 0.0;
+}
+
+
+void MultiStreamPlayer::setBarrier(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_barrier = enable;
+}
+
+
+void MultiStreamPlayer::setPrefetch(int frames)
+{
+    bool running = isRunning();
+    halt();
+    m_prefetch = std::max(0, frames);
+    for ( std::unique_ptr<Stream>& s : m_streams ) {
+        s->source.setPrefetch(m_prefetch);
+    }
+    if ( running ) {
+        play();
+    }
+}
+
+
+void MultiStreamPlayer::setPriority(Executor::Priority priority)
+{
+    m_priority = priority;
+    for ( std::unique_ptr<Stream>& s : m_streams ) {
+        s->source.setPriority(priority);
+    }
+}
+
+
+void MultiStreamPlayer::play()
+{
+    if ( ! isRunning() && ! m_streams.empty() )
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stop = false;
+        }
+        start(LowPriority);
+    }
+}
+
+
+void MultiStreamPlayer::stop(bool stop)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stop = stop;
+}
+
+
+void MultiStreamPlayer::close()
+{
+    halt();
+    QMutexLocker locker(&m_mutex);
+    m_streams.clear();
+    m_clockMs = 0.0;
+    m_clockRate = VideoDefs::DEFAULT_FRAME_RATE;
+}
+
+
+bool MultiStreamPlayer::go(int relativeFrame)
+{
+    halt();
+    int frameNumber = getCurrentFrame() + relativeFrame;
+    if ( ! setCurrentFrame(frameNumber) ) {
+        return false;
+    }
+    VIDEN_TRACE_SCOPE("seek");
+    present(m_clockMs, true);
+    emit frameSetDone(m_clockMs);
+    return true;
+}
+
+
+QString MultiStreamPlayer::name() const
+{
+    return name(0);
+}
+
+
+QString MultiStreamPlayer::name(int stream) const
+{
+    return stream >= 0 && stream < streamCount() ? m_streams[stream]->name : QString();
+}
+
+
+bool MultiStreamPlayer::setCurrentFrame(int frameNumber)
+{
+    if ( frameNumber <= VideoDefs::INVALID_FRAME_NUMBER || frameNumber >= getNumberOfFrames() ) {
+        return false;
+    }
+    halt();
+    seekAll(frameNumber * 1000.0 / m_clockRate);
+    return true;
+}
+
+
+int MultiStreamPlayer::getFrameRate() const
+{
+    return static_cast<int>(m_clockRate);
+}
+
+
+int MultiStreamPlayer::getCurrentFrame() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>( std::floor(m_clockMs * m_clockRate / 1000.0 + 1e-6) );
+}
+
+
+int MultiStreamPlayer::getNumberOfFrames() const
+{
+    double endMs = 0.0;
+    for ( const std::unique_ptr<Stream>& s : m_streams ) {
+        endMs = std::max(endMs, s->offsetMs + s->frameCount * 1000.0 / s->frameRate);
+    }
+    return static_cast<int>( std::ceil(endMs * m_clockRate / 1000.0 - 1e-6) );
+}
+
+
+double MultiStreamPlayer::clockTime() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_clockMs;
+}
+
+
+void MultiStreamPlayer::setSpeed(Speed speed)
+{
+    QMutexLocker locker(&m_mutex);
+    m_speed = speed;
+}
+
+
+void MultiStreamPlayer::run()
+{
+    VIDEN_TRACE_THREAD_NAME("MultiStreamPlayer");
+    QElapsedTimer wall;
+    wall.start();
+    m_mutex.lock();
+    double baseMs = m_clockMs;  // clock time at the start of wall
+    Speed lastSpeed = m_speed;
+    m_mutex.unlock();
+
+    while( ! m_stop )
+    {
+        VIDEN_METRICS_LOCK(m_metrics, m_mutex);
+        double clockMs = m_clockMs;
+        double tickMs = 1000.0 / m_clockRate;
+        Speed speed = m_speed;
+        bool barrier = m_barrier;
+        m_mutex.unlock();
+
+        if ( speed != lastSpeed ) {
+            baseMs = clockMs;
+            wall.restart();
+            lastSpeed = speed;
+        }
+        bool fast = speed == Speed::Fast;
+
+        bool running = present(clockMs, barrier || fast);
+        emit frameSetDone(clockMs);
+#if VIDEN_ENABLE_METRICS
+        VIDEN_METRICS_COUNT(m_metrics, Frames);
+        if ( m_metrics.reportDue() ) {
+            emit metricsUpdated( m_metrics.snapshot() );
+        }
+#endif
+        if ( ! running ) {
+            VIDEN_METRICS_LOCK(m_metrics, m_mutex);
+            m_stop = true;
+            m_mutex.unlock();
+            emit donePlay(true);
+            break;
+        }
+
+        double nextMs = clockMs + tickMs;
+        if ( ! fast )
+        {
+            double scale = static_cast<int>(speed) / 1000.0; // wall ms per clock ms
+            double dueMs = (nextMs - baseMs) * scale;
+            double elapsedMs = wall.nsecsElapsed() / 1e6;
+            if ( elapsedMs < dueMs ) {
+                VIDEN_METRICS_SCOPE(m_metrics, Sleep);
+                VIDEN_TRACE_SCOPE("sleep");
+                sleepMiliSecond( static_cast<int>(dueMs - elapsedMs) );
+            }
+            else if ( barrier ) {
+                baseMs = nextMs - elapsedMs / scale; // the group was held, continue from here
+            }
+            else {
+                nextMs = std::max(nextMs, baseMs + elapsedMs / scale); // catch up with the wall time
+            }
+        }
+        VIDEN_METRICS_LOCK(m_metrics, m_mutex);
+        m_clockMs = nextMs;
+        m_mutex.unlock();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///                              PRIVATE FUNCTIONS
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+bool MultiStreamPlayer::present(double clockMs, bool blocking)
+{
+    bool running = false;
+    for ( size_t i=0; i<m_streams.size(); ++i )
+    {
+        Stream& s = *m_streams[i];
+        int target = streamFrame(s, clockMs);
+        if ( s.source.atEnd() || (s.frameCount > 0 && target >= s.frameCount) ) {
+            continue; // ended, keeps showing its last frame
+        }
+        running = true;
+        if ( target < 0 || (s.view.isValid() && s.view.frameNumber() >= target) ) {
+            continue; // not started yet or the frame is still current
+        }
+        if ( s.view.isValid() && target - s.view.frameNumber() > s.frameRate ) {
+            // more than a second behind, seeking is cheaper than decoding the frames in between
+            VIDEN_TRACE_SCOPE("seek");
+            s.source.seek(target);
+        }
+
+        // take frames up to the target, a late frame is shown if the target is not decoded yet
+        FrameView view, candidate;
+        for (;;)
+        {
+            bool ok;
+            {
+                VIDEN_METRICS_SCOPE(m_metrics, Decode);
+                ok = blocking ? s.source.next(view) : s.source.tryNext(view);
+            }
+            if ( ! ok ) {
+                break;
+            }
+            if ( candidate.isValid() ) {
+                VIDEN_METRICS_COUNT(m_metrics, Drops);
+            }
+            candidate = std::move(view);
+            if ( candidate.frameNumber() >= target ) {
+                break;
+            }
+        }
+        if ( ! candidate.isValid() ) {
+            continue;
+        }
+        {
+            VIDEN_METRICS_SCOPE(m_metrics, Wrap);
+            s.variant.setValue( candidate.image() ); // drops the reference to the shown buffer first
+        }
+        s.view = std::move(candidate); // the pool reuses the old buffer once no receiver holds it
+        VIDEN_METRICS_SCOPE(m_metrics, Emit);
+        VIDEN_TRACE_SCOPE("emit");
+        emit newFrame( static_cast<int>(i), s.variant, s.view.frameNumber() );
+    }
+    return running;
+}
+
+
+void MultiStreamPlayer::seekAll(double clockMs)
+{
+    for ( std::unique_ptr<Stream>& s : m_streams )
+    {
+        int target = std::max(0, streamFrame(*s, clockMs));
+        if ( s->frameCount > 0 ) {
+            target = std::min(target, s->frameCount-1);
+        }
+        s->view.release();
+        s->source.seek(target);
+    }
+    QMutexLocker locker(&m_mutex);
+    m_clockMs = clockMs;
+}
+
+
+void MultiStreamPlayer::halt()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+    }
+    wait();
+}
+
+
+/////////////////////////////////////////////////END OF FILE///////////////////////////////////////
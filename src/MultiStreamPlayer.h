@@ -0,0 +1,220 @@
+#ifndef MULTISTREAMPLAYER_H
+#define MULTISTREAMPLAYER_H
+/** ***********************************************************
+ * @file MultiStreamPlayer.h
+ * @brief Synchronized playback of several videos or image sequences, e.g. a multi-camera rig.
+*/
+
+#include <QObject>
+#include <QMutex>
+#include <QThread>
+#include <QVariant>
+
+#include <opencv2/core/core.hpp>
+
+#include "Player.h"
+#include "FrameSource.h"
+#include "PlayerMetrics.h"
+
+#include <vector>
+#include <memory>
+#include <cmath>
+
+
+namespace oscv
+{
+/**
+ * @brief The MultiStreamPlayer class plays N streams from one presentation clock.
+ *
+ *        The streams decode in FrameSource prefetch tasks on the shared Executor, the player thread
+ *        only runs the clock and emits the frames. At clock time t (ms) stream i shows its frame
+ *        floor((t - offset_i) * frameRate_i / 1000), so streams with different frame rates or start
+ *        times stay aligned. A stream which falls behind drops frames to catch up, or, with
+ *        setBarrier(true), holds the clock of the whole group until its frame is decoded.
+ *
+ *        The IPlayer frame numbers count ticks of the clock at the highest frame rate of the streams.
+ *        Seeking seeks all streams.
+ */
+class MultiStreamPlayer : public QThread, public IPlayer
+{
+
+    Q_OBJECT
+
+public:
+
+     MultiStreamPlayer(QObject *parent = 0);
+
+     ~MultiStreamPlayer();
+
+     /**
+      * @brief open close all streams and open the given file as the only one
+      */
+     bool open(QString filename);
+
+     /**
+      * @brief addStream open another stream, the player has to be stopped
+      * @param filename video or any image of a sequence
+      * @param offsetMs clock time at which the first frame of the stream is shown
+      * @return index of the stream, -1 if the file cannot be opened
+      */
+     int addStream(const QString& filename, double offsetMs=0.0);
+
+     inline int streamCount() const;
+
+     /**
+      * @brief setOffset clock time of the first frame of a stream, e.g. from the timestamps of a rig
+      * @param stream index from addStream()
+      * @param offsetMs
+      */
+     void setOffset(int stream, double offsetMs);
+
+     double offset(int stream) const;
+
+     /**
+      * @brief setBarrier true: a slow stream holds the group, no frame is dropped.
+      *        false: the clock follows the wall time, slow streams drop frames. Default false.
+      */
+     void setBarrier(bool enable);
+
+     inline bool isBarrier() const;
+
+     /**
+      * @brief setPrefetch frames decoded ahead per stream, @see FrameSource::setPrefetch()
+      */
+     void setPrefetch(int frames);
+
+     /**
+      * @brief setPriority executor priority class of the decode tasks of all streams
+      */
+     void setPriority(Executor::Priority priority);
+
+     //! Play all streams from the current clock time
+     void play();
+
+     void stop(bool stop=true);
+
+     //! Close all streams
+     void close();
+
+     bool go(int relativeFrame=1);
+
+     inline bool isStopped() const;
+
+     //! File name of the first stream
+     QString name() const;
+
+     QString name(int stream) const;
+
+     //! Seek all streams to the clock time of the given tick
+     bool setCurrentFrame(int frameNumber);
+
+     //! Rate of the clock, the highest frame rate of the streams
+     int getFrameRate() const;
+
+     //! Tick of the clock
+     int getCurrentFrame() const;
+
+     //! Ticks until the last stream ends
+     int getNumberOfFrames() const;
+
+     //! Current clock time in ms
+     double clockTime() const;
+
+     void setSpeed(Speed speed);
+
+     /**
+      * @brief metrics Decode is the time waiting for the streams, Drops counts frames dropped to
+      *        catch up with the clock. @see PlayerMetrics
+      */
+     inline PlayerMetrics& metrics();
+
+signals:
+
+    //! A stream shows a new frame
+    void newFrame(int stream, const QVariant v, int frameNum);
+
+    //! All streams have been updated for the given clock time (ms)
+    void frameSetDone(double clockMs);
+
+    //! To application
+    void donePlay(bool done);
+
+    //! Emitted from the player thread every PlayerMetrics::reportInterval() ms while playing
+    void metricsUpdated(const oscv::PlayerMetrics::Snapshot& snapshot);
+
+protected:
+    //! Override QThread
+     void run();
+
+private:
+    struct Stream
+    {
+        QString name;
+        FrameSource source;
+        double offsetMs;
+        double frameRate;
+        int frameCount;   // 0 if unknown
+        FrameView view;   // shown frame, its buffer stays valid until the next one is shown
+        QVariant variant;
+    };
+
+    //! Frame of a stream at the given clock time, may be negative or behind its end
+    inline int streamFrame(const Stream& stream, double clockMs) const;
+
+    /**
+     * @brief present bring every stream to its frame at the clock time and emit the new frames
+     * @param blocking wait for the streams, otherwise a stream whose frame is not decoded yet keeps its frame
+     * @return false if all streams have ended
+     */
+    bool present(double clockMs, bool blocking);
+
+    //! Seek all streams to the clock time, the player thread must not run
+    void seekAll(double clockMs);
+
+    //! Stop the player thread and wait for it
+    void halt();
+
+    std::vector< std::unique_ptr<Stream> > m_streams;
+    double m_clockMs;
+    double m_clockRate;
+    bool m_stop;
+    bool m_barrier;
+    int m_prefetch;
+    Executor::Priority m_priority;
+    Speed m_speed;
+    mutable QMutex m_mutex;
+    PlayerMetrics m_metrics;
+};
+
+///////////////////////////////////////IMPLEMENTATION///////////////////////////////////////
+
+int MultiStreamPlayer::streamCount() const
+{
+    return static_cast<int>(m_streams.size());
+}
+
+bool MultiStreamPlayer::isBarrier() const
+{
+    return m_barrier;
+}
+
+bool MultiStreamPlayer::isStopped() const
+{
+    return m_stop;
+}
+
+PlayerMetrics& MultiStreamPlayer::metrics()
+{
+    return m_metrics;
+}
+
+int MultiStreamPlayer::streamFrame(const Stream& stream, double clockMs) const
+{
+    // small epsilon, a tick exactly on a frame time must not round down to the previous frame
+    return static_cast<int>( std::floor((clockMs - stream.offsetMs) * stream.frameRate / 1000.0 + 1e-6) );
+}
+
+} // end namespace
+
+
+#endif // MULTISTREAMPLAYER_H
@@ -0,0 +1,246 @@
+#include "OcvUtils.h"
+#include "DftConvolver.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace oscv;
+
+
+namespace
+{
+    // Histogram of an 8 or 16 bit image, the value v is counted in bin v+offset
+    template<typename T>
+    void countHistogram(const cv::Mat& img, std::vector<int>& hist, int offset)
+    {
+        int n = img.cols*img.channels();
+        for ( int i=0; i<img.rows; ++i ) {
+            const T* p = img.ptr<T>(i);
+            for ( int j=0; j<n; ++j ) {
+                hist[p[j]+offset]++;
+            }
+        }
+    }
+
+    // Histogram of any depth, binned between minV and maxV
+    template<typename T>
+    void countBinnedHistogram(const cv::Mat& img, std::vector<int>& hist, double minV, double scale)
+    {
+        int n = img.cols*img.channels();
+        int last = static_cast<int>(hist.size())-1;
+        for ( int i=0; i<img.rows; ++i ) {
+            const T* p = img.ptr<T>(i);
+            for ( int j=0; j<n; ++j ) {
+                int bin = static_cast<int>((p[j]-minV)*scale);
+                hist[std::min(std::max(bin, 0), last)]++;
+            }
+        }
+    }
+
+    // Apply a lookup table to rows of an 8 or 16 bit image
+    template<typename T>
+    class LutBody : public cv::ParallelLoopBody
+    {
+    public:
+        LutBody(const cv::Mat& src, cv::Mat& dst, const uchar* lut, int offset)
+            : m_src(src), m_dst(dst), m_lut(lut), m_offset(offset)
+        {
+        }
+
+        void operator()(const cv::Range& range) const
+        {
+            int n = m_src.cols*m_src.channels();
+            for ( int i=range.start; i<range.end; ++i ) {
+                const T* s = m_src.ptr<T>(i);
+                uchar* d = m_dst.ptr<uchar>(i);
+                for ( int j=0; j<n; ++j ) {
+                    d[j] = m_lut[s[j]+m_offset];
+                }
+            }
+        }
+
+    private:
+        const cv::Mat& m_src;
+        cv::Mat& m_dst;
+        const uchar* m_lut;
+        int m_offset;
+    };
+}
+
+
+bool OcvUtils::convolveDFT(cv::Mat& inA, cv::Mat& inB, cv::Mat& out)
+{
+    DftConvolver convolver(inB);
+    if ( ! convolver.apply(inA, out) ) {
+        out.release(); // no stale result of an earlier call
+        return false;
+    }
+    return true;
+}
+
+
+// sin(x) = sin(r + k*pi/2) with |r| <= pi/4, r and z=r*r go into minimax polynomials (Cephes coefficients)
+void OcvUtils::sinCosRow(const float* in, float* out, int n, double scale, bool cosine)
+{
+    const float TWO_OVER_PI = 0.636619772367581343f;
+    // pi/2 split in three parts so that k*PIO2_1 and k*PIO2_2 are exact
+    const float PIO2_1 = 1.5703125f;
+    const float PIO2_2 = 4.837512969970703125e-4f;
+    const float PIO2_3 = 7.54978995489188216e-8f;
+    const float fscale = static_cast<float>(scale);
+    const int offset = cosine? 1 : 0;
+    for ( int j=0; j<n; ++j ) {
+        float x = in[j]*fscale;
+        // round to nearest by adding and subtracting 1.5*2^23, valid for |x| < 2^22
+        float fk = (x*TWO_OVER_PI + 12582912.0f) - 12582912.0f;
+        int k = static_cast<int>(fk);
+        float r = ((x - fk*PIO2_1) - fk*PIO2_2) - fk*PIO2_3;
+        float z = r*r;
+        float s = r + r*z*(-1.6666654611e-1f + z*(8.3321608736e-3f + z*(-1.9515295891e-4f)));
+        float c = 1.0f - 0.5f*z + z*z*(4.166664568298827e-2f + z*(-1.388731625493765e-3f + z*2.443315711809948e-5f));
+        // branch free quadrant selection, odd: cos, even: sin, quadrant 2 and 3 negate
+        int q = k + offset;
+        float odd = static_cast<float>(q & 1);
+        float sign = static_cast<float>(1 - (q & 2));
+        out[j] = sign*(odd*c + (1.0f-odd)*s);
+    }
+}
+
+void OcvUtils::sinCosRow(const double* in, double* out, int n, double scale, bool cosine)
+{
+    const double TWO_OVER_PI = 0.63661977236758134308;
+    // pi/2 split in three parts so that k*PIO2_1 and k*PIO2_2 are exact
+    const double PIO2_1 = 1.57079625129699707031;
+    const double PIO2_2 = 7.54978941586159635335e-8;
+    const double PIO2_3 = 5.39030285815811905290e-15;
+    const int offset = cosine? 1 : 0;
+    for ( int j=0; j<n; ++j ) {
+        double x = in[j]*scale;
+        // round to nearest by adding and subtracting 1.5*2^52
+        double fk = (x*TWO_OVER_PI + 6755399441055744.0) - 6755399441055744.0;
+        int k = static_cast<int>(fk);
+        double r = ((x - fk*PIO2_1) - fk*PIO2_2) - fk*PIO2_3;
+        double z = r*r;
+        double s = r + r*z*(-1.66666666666666307295e-1 + z*(8.33333333332211858878e-3 + z*(-1.98412698295895385996e-4
+                   + z*(2.75573136213857245213e-6 + z*(-2.50507477628578072866e-8 + z*1.58962301576546568060e-10)))));
+        double c = 1.0 - 0.5*z + z*z*(4.16666666666665929218e-2 + z*(-1.38888888888730564116e-3 + z*(2.48015872888517045348e-5
+                   + z*(-2.75573141792967388112e-7 + z*(2.08757008419747316778e-9 + z*(-1.13585365213876817300e-11))))));
+        // branch free quadrant selection, odd: cos, even: sin, quadrant 2 and 3 negate
+        int q = k + offset;
+        double odd = static_cast<double>(q & 1);
+        double sign = static_cast<double>(1 - (q & 2));
+        out[j] = sign*(odd*c + (1.0-odd)*s);
+    }
+}
+
+
+bool OcvUtils::stretchRange(const cv::Mat& img, double& low, double& high, double filterMin, double filterMax)
+{
+    if ( img.empty() || filterMin < 0 || filterMax < 0 || filterMin+filterMax >= 100 )
+        return false;
+
+    // bin i covers [first + i*width, first + (i+1)*width)
+    std::vector<int> hist;
+    double first = 0, width = 1;
+    switch ( img.depth() ) {
+        case CV_8U:  hist.assign(256, 0);   countHistogram<uchar>(img, hist, 0); break;
+        case CV_8S:  hist.assign(256, 0);   countHistogram<schar>(img, hist, 128); first = -128; break;
+        case CV_16U: hist.assign(65536, 0); countHistogram<ushort>(img, hist, 0); break;
+        case CV_16S: hist.assign(65536, 0); countHistogram<short>(img, hist, 32768); first = -32768; break;
+        default:
+        {
+            double minV, maxV;
+            cv::minMaxLoc(img.reshape(1), &minV, &maxV);
+            if ( maxV <= minV ) {
+                low = minV;
+                high = minV+1;
+                return true;
+            }
+            hist.assign(STRETCH_HIST_BINS, 0);
+            first = minV;
+            width = (maxV-minV)/STRETCH_HIST_BINS;
+            double scale = 1.0/width;
+            switch ( img.depth() ) {
+                case CV_32S: countBinnedHistogram<int>(img, hist, minV, scale); break;
+                case CV_32F: countBinnedHistogram<float>(img, hist, minV, scale); break;
+                default:     countBinnedHistogram<double>(img, hist, minV, scale); break;
+            }
+        }
+    }
+
+    double total = static_cast<double>(img.total()*img.channels());
+    double lowCount = total*filterMin/100;
+    double highCount = total*filterMax/100;
+    int bins = static_cast<int>(hist.size());
+
+    int lowBin = 0;
+    for ( double sum = hist[0]; sum <= lowCount && lowBin < bins-1; sum += hist[++lowBin] ) {}
+    int highBin = bins-1;
+    for ( double sum = hist[bins-1]; sum <= highCount && highBin > 0; sum += hist[--highBin] ) {}
+
+    low = first + lowBin*width;
+    high = first + (highBin+1)*width;
+    // integer images: the top bin value itself is the upper clip point
+    if ( width == 1 ) {
+        high -= 1;
+    }
+    if ( high <= low ) {
+        high = low+1;
+    }
+    return true;
+}
+
+void OcvUtils::applyStretch(const cv::Mat& img, cv::Mat& out, double low, double high, int a_min, int a_max)
+{
+    std::vector<uchar> lut;
+    if ( stretchLut(img.depth(), low, high, a_min, a_max, lut) ) {
+        applyLut(img, out, lut);
+        return;
+    }
+
+    // convertTo saturates to [0,255], the clip to [a_min, a_max] is only needed for a narrower range
+    double scale = (a_max-a_min)/(high-low);
+    img.convertTo(out, CV_8U, scale, a_min - low*scale);
+    if ( a_min > 0 ) {
+        cv::max(out, double(a_min), out);
+    }
+    if ( a_max < 255 ) {
+        cv::min(out, double(a_max), out);
+    }
+}
+
+bool OcvUtils::stretchLut(int depth, double low, double high, int a_min, int a_max, std::vector<uchar>& lut)
+{
+    if ( depth != CV_8U && depth != CV_8S && depth != CV_16U && depth != CV_16S ) {
+        return false;
+    }
+    double scale = (a_max-a_min)/(high-low);
+    int size = ( depth == CV_8U || depth == CV_8S )? 256 : 65536;
+    int offset = ( depth == CV_8S )? 128 : ( depth == CV_16S )? 32768 : 0;
+    lut.resize(size);
+    for ( int i=0; i<size; ++i ) {
+        double v = a_min + (i-offset-low)*scale;
+        lut[i] = cv::saturate_cast<uchar>( std::min(std::max(v, double(a_min)), double(a_max)) );
+    }
+    return true;
+}
+
+void OcvUtils::applyLut(const cv::Mat& img, cv::Mat& out, const std::vector<uchar>& lut)
+{
+    int depth = img.depth();
+    size_t size = ( depth == CV_8U || depth == CV_8S )? 256 : 65536;
+    if ( lut.size() != size ) {
+        return; // not a table of stretchLut for this depth
+    }
+    out.create(img.size(), CV_8UC(img.channels()));
+    switch ( depth ) {
+        case CV_8U:  cv::LUT(img, cv::Mat(1, 256, CV_8U, const_cast<uchar*>(&lut[0])), out); break;
+        case CV_8S:  cv::parallel_for_(cv::Range(0, img.rows), LutBody<schar>(img, out, &lut[0], 128)); break;
+        case CV_16U: cv::parallel_for_(cv::Range(0, img.rows), LutBody<ushort>(img, out, &lut[0], 0)); break;
+        case CV_16S: cv::parallel_for_(cv::Range(0, img.rows), LutBody<short>(img, out, &lut[0], 32768)); break;
+        default: break;
+    }
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -5,6 +5,10 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
 
 namespace oscv
 {
@@ -14,24 +18,33 @@ namespace oscv
         /**
          * @brief ShiftDft Rearrange the quadrants of Fourier Mat image so that the viewing in frequency domain becomes more meaningful
          *       The bottom-left of the image will be swapped between quater 0 and 3 and between 1 and 2.
+         *       The shift is done in place without allocation. For odd sizes the origin moves to
+         *       (cols/2, rows/2) like fftshift, and inverse=true moves it back like ifftshift.
          *
-         * @param src as in/out
+         * @param src as in/out, any type
+         * @param inverse false to move the origin to the center, true to move it back to (0,0)
          */
-        static inline void ShiftDft(cv::Mat& src);
+        static inline void ShiftDft(cv::Mat& src, bool inverse=false);
 
 
         /**
-         * @brief convolveDFT
-         * @param inA
-         * @param inB
-         * @param out
+         * @brief convolveDFT Convolve a single channel image with a kernel ("same" size, zero border).
+         *        Large kernels are convolved in the frequency domain, small ones directly.
+         *        This builds a new plan on every call, use @see DftConvolver to filter frame after frame.
+         * @param inA single channel image
+         * @param inB single channel kernel, its origin is at (cols/2, rows/2)
+         * @param out CV_32F (CV_64F if the kernel is CV_64F) image of the size of inA, empty on failure
+         * @return false if the kernel is empty or a type is not supported, @see DftConvolver::apply()
          */
-        static void convolveDFT(cv::Mat& inA, cv::Mat& inB, cv::Mat& out);
+        static bool convolveDFT(cv::Mat& inA, cv::Mat& inB, cv::Mat& out);
 
         /**
          * @brief cosine Cos of cv::Mat angle
+         *        float and double Mats are computed with a vectorized polynomial, the absolute error is
+         *        below 1.5e-7 (float, |angle| <= 8192 rad) and 5e-16 (double, |angle| <= 1e6 rad).
+         *        Other types are computed with std::cos. out may be the same Mat as angle.
          * @param angle angle as radian if angle is degree, the isDegree must be set.
-         * @param out Cos of angle in cv::Mat
+         * @param out Cos of angle in cv::Mat, created with the size of angle
          * @param isDegree default is false (radian)
          */
 
@@ -39,7 +52,7 @@ namespace oscv
         static void cosine(const cv::Mat_<T>& angle, cv::Mat_<T>& out, bool isDegree=false);
 
         /**
-         * @brief sine Sin of cv::Mat angle
+         * @brief sine Sin of cv::Mat angle, with the same accuracy as @see cosine
          * @param angle
          * @param out
          * @param isDegree
@@ -65,45 +78,142 @@ namespace oscv
          */
         static inline void matTypeAsString(int type, std::string& typeAsString );
 
+        /**
+         * @brief isShared True if another Mat refers to the data of img as well. Writing into a buffer
+         *        which is not shared, e.g. with create() of the same size and type, is seen by nobody else.
+         */
+        static inline bool isShared(const cv::Mat& img);
+
         /**
          * @brief stretchImage Similar to equalizeHist but this function can perform on any Matrix not
-         *              confined only to input 8UC1.
+         *              confined only to input 8UC1. The values between the clip points found by
+         *              @see stretchRange are mapped linearly to [a_min, a_max], see @see applyStretch.
          * @param img
-         * @param out
+         * @param out 8U output, reused if it has the size of img
          * @param a_min
          * @param a_max
-         * @param filterMin percent of  minimum threshold value to remove noise
-         * @param filterMax percent of maximum threshould valule to remove noise
+         * @param filterMin percent of the darkest pixels clipped to a_min to remove noise
+         * @param filterMax percent of the brightest pixels clipped to a_max to remove noise
+         * @return false if the parameters are out of range or the image is empty
          */
         template<typename T>
         static bool stretchImage(const cv::Mat_<T>& img, cv::Mat_<uchar>& out, int a_min=0, int a_max=255, double filterMin=10, double filterMax=10);
 
+        /**
+         * @brief stretchRange percentile clip points of the image from its histogram.
+         *        8 and 16 bit images are counted exactly in one pass, other depths are binned
+         *        into STRETCH_HIST_BINS bins between their minimum and maximum.
+         * @param img image of any depth, all channels are counted together
+         * @param low[out] value below which filterMin percent of the pixels are
+         * @param high[out] value above which filterMax percent of the pixels are, always > low
+         * @param filterMin percent of pixels to clip at the low end
+         * @param filterMax percent of pixels to clip at the high end
+         * @return false if the image is empty or the percentages are out of range
+         */
+        static bool stretchRange(const cv::Mat& img, double& low, double& high, double filterMin=10, double filterMax=10);
+
+        /**
+         * @brief applyStretch map [low, high] of the image linearly to [a_min, a_max] and clip the rest.
+         *        8 and 16 bit images go through a lookup table, the other depths through the
+         *        vectorized cv::Mat::convertTo. Rows are processed in parallel.
+         * @param img image of any depth
+         * @param out 8U output with the channels of img, reused if it has the right size
+         * @param low
+         * @param high
+         * @param a_min
+         * @param a_max
+         */
+        static void applyStretch(const cv::Mat& img, cv::Mat& out, double low, double high, int a_min=0, int a_max=255);
+
+        /**
+         * @brief stretchLut the lookup table of @see applyStretch, to map frame after frame with the
+         *        same range without building the table again, @see applyLut
+         * @param depth CV_8U, CV_8S, CV_16U or CV_16S
+         * @param lut[out] 256 or 65536 entries, reused
+         * @return false for other depths
+         */
+        static bool stretchLut(int depth, double low, double high, int a_min, int a_max, std::vector<uchar>& lut);
+
+        /**
+         * @brief applyLut map an 8 or 16 bit image through a table of @see stretchLut, rows in parallel
+         * @param img
+         * @param out 8U output with the channels of img, reused if it has the right size
+         * @param lut table built for the depth of img
+         */
+        static void applyLut(const cv::Mat& img, cv::Mat& out, const std::vector<uchar>& lut);
+
+        /**
+         * @brief STRETCH_HIST_BINS Number of histogram bins of @see stretchRange for 32 bit and float images
+         */
+        static const int STRETCH_HIST_BINS = 4096;
+
+    private:
+        /**
+         * @brief sinCosRow sin or cos of n values of a row. The float and double versions are
+         *        branch free so that the compiler vectorizes them. The range reduction relies on
+         *        IEEE rounding, do not build OcvUtils.cpp with -ffast-math.
+         * @param in angles
+         * @param out results, may be equal to in
+         * @param n number of values
+         * @param scale factor applied to the angles first (1 or pi/180)
+         * @param cosine true for cos, false for sin
+         */
+        static void sinCosRow(const float* in, float* out, int n, double scale, bool cosine);
+
+        static void sinCosRow(const double* in, double* out, int n, double scale, bool cosine);
+
+        template<typename T>
+        static void sinCosRow(const T* in, T* out, int n, double scale, bool cosine);
+
+        /**
+         * @brief reverseRows reverse the order of the rows [from, to) in place
+         */
+        static inline void reverseRows(cv::Mat& src, int from, int to);
+
 
     };
 
      /////////////////////////////INLINE
 
-    void OcvUtils::ShiftDft(cv::Mat& src)
+    bool OcvUtils::isShared(const cv::Mat& img)
+    {
+#ifdef OPENCV_3
+        return img.u != NULL && img.u->refcount > 1;
+#else
+        return img.refcount != NULL && *img.refcount > 1;
+#endif
+    }
+
+    void OcvUtils::ShiftDft(cv::Mat& src, bool inverse)
+    {
+        // rearrange the quadrants of Fourier image so that the origin is at the image center.
+        // This is a cyclic rotation of every row by cx elements and of the rows by cy rows,
+        // for even sizes the same as swapping quater 0 with 3 and 1 with 2.
+        int cx = inverse? src.cols/2 : (src.cols+1)/2;
+        int cy = inverse? src.rows/2 : (src.rows+1)/2;
+        size_t elemSize = src.elemSize();
+        size_t rowBytes = src.cols*elemSize;
+
+        if ( cx > 0 && cx < src.cols ) {
+            for ( int i=0; i<src.rows; ++i ) {
+                uchar* row = src.ptr(i);
+                std::rotate(row, row + cx*elemSize, row + rowBytes);
+            }
+        }
+        // rotation of the rows by three reversals, rows of a ROI are not contiguous
+        if ( cy > 0 && cy < src.rows ) {
+            reverseRows(src, 0, cy);
+            reverseRows(src, cy, src.rows);
+            reverseRows(src, 0, src.rows);
+        }
+    }
+
+    void OcvUtils::reverseRows(cv::Mat& src, int from, int to)
     {
-        int cx = src.cols/2;
-        int cy = src.rows/2;
-
-        // rearrange the quadrants of Fourier image
-        // so that the origin is at the image center
-        cv::Mat tmp;
-        // Rect started at bottom-left as (x,y), whereas cx, cy is its widtht and height.
-        cv::Mat q0(src, cv::Rect(0, 0, cx, cy));
-        cv::Mat q1(src, cv::Rect(cx, 0, cx, cy));
-        cv::Mat q2(src, cv::Rect(0, cy, cx, cy));
-        cv::Mat q3(src, cv::Rect(cx, cy, cx, cy));
-
-        q0.copyTo(tmp);
-        q3.copyTo(q0);
-        tmp.copyTo(q3);
-
-        q1.copyTo(tmp);
-        q2.copyTo(q1);
-        tmp.copyTo(q2);
+        size_t rowBytes = src.cols*src.elemSize();
+        for ( --to; from < to; ++from, --to ) {
+            std::swap_ranges(src.ptr(from), src.ptr(from) + rowBytes, src.ptr(to));
+        }
     }
 
     void OcvUtils::matTypeAsString(int type, std::string& typeAsString )
@@ -129,31 +239,24 @@ namespace oscv
     template<typename T>
     bool OcvUtils::stretchImage(const cv::Mat_<T>& img, cv::Mat_<uchar>& out, int a_min, int a_max, double filterMin, double filterMax)
     {
-        if ( a_min < 0 || a_max > 255 || filterMin < 1.0 || filterMax > 254.0 )
+        if ( a_min < 0 || a_max > 255 || a_min >= a_max )
             return false;
 
-        double minV,maxV;
-        cv::minMaxLoc(img, &minV, &maxV);
-        double factor = (a_max - a_min)/(maxV - minV);
-        double minVal = minV+(factor*filterMin/100);
-        double maxVal = maxV-(factor*filterMax/100);
-        for(int i=0; i< img.rows; ++i) {
-           for(int j=0; j< img.cols; ++j) {
-               double v = factor*img(i,j);
-                v = v < minVal? a_min : v > maxVal? a_max: v;
-               out(i,j) = static_cast<uchar>(  round(v) );
-           }
-        }
+        double low, high;
+        if ( ! stretchRange(img, low, high, filterMin, filterMax) )
+            return false;
+
+        applyStretch(img, out, low, high, a_min, a_max);
         return true;
     }
 
     template<typename T>
     void OcvUtils::cosine(const cv::Mat_<T>& angle, cv::Mat_<T>& out, bool isDegree)
     {
+        out.create(angle.rows, angle.cols);
+        double scale = (isDegree)? M_PI/180.0 : 1.0;
         for(int i=0; i< angle.rows; ++i) {
-           for(int j=0; j<angle.cols; ++j) {
-               out(i,j) = (isDegree)? cos(angle(i,j)*M_PI/180.0) : cos(angle(i,j));
-           }
+           sinCosRow(angle[i], out[i], angle.cols*angle.channels(), scale, true);
         }
 
     }
@@ -161,14 +264,23 @@ namespace oscv
     template<typename T>
     void OcvUtils::sine(const cv::Mat_<T>& angle, cv::Mat_<T>& out, bool isDegree)
     {
+        out.create(angle.rows, angle.cols);
+        double scale = (isDegree)? M_PI/180.0 : 1.0;
         for(int i=0; i< angle.rows; ++i) {
-           for(int j=0; j<angle.cols; ++j) {
-               out(i,j) = (isDegree)? sin(angle(i,j)*M_PI/180.0) : sin(angle(i,j));
-           }
+           sinCosRow(angle[i], out[i], angle.cols*angle.channels(), scale, false);
         }
 
     }
 
+    template<typename T>
+    void OcvUtils::sinCosRow(const T* in, T* out, int n, double scale, bool cosine)
+    {
+        for(int j=0; j<n; ++j) {
+            double x = in[j]*scale;
+            out[j] = static_cast<T>( (cosine)? std::cos(x) : std::sin(x) );
+        }
+    }
+
 
 } // end namespace
 
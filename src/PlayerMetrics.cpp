@@ -0,0 +1,118 @@
+#include "PlayerMetrics.h"
+
+#include <cmath>
+
+using namespace oscv;
+
+
+namespace
+{
+    const char* const STAGE_NAMES[PlayerMetrics::STAGE_COUNT] =
+        { "decode", "mutex_wait", "process", "wrap", "emit", "sleep" };
+
+    const char* const COUNTER_NAMES[PlayerMetrics::COUNTER_COUNT] =
+        { "frames", "drops", "cache_hits", "cache_misses", "skipped" };
+}
+
+
+double PlayerMetrics::StageStats::meanNs() const
+{
+    return count ? static_cast<double>(totalNs) / count : 0.0;
+}
+
+quint64 PlayerMetrics::StageStats::percentileNs(double percent) const
+{
+    if ( count == 0 ) {
+        return 0;
+    }
+    quint64 rank = static_cast<quint64>( std::ceil(percent / 100.0 * count) );
+    rank = rank < 1 ? 1 : rank;
+    quint64 seen = 0;
+    for ( int i=0; i<BUCKETS; ++i ) {
+        seen += buckets[i];
+        if ( seen >= rank ) {
+            // the maximum is a tighter bound than the end of its bucket
+            quint64 upper = i < BUCKETS-1 ? (quint64(1) << (i+1)) - 1 : maxNs;
+            return upper < maxNs ? upper : maxNs;
+        }
+    }
+    return maxNs;
+}
+
+PlayerMetrics::PlayerMetrics()
+    : m_reportIntervalMs(0)
+{
+    reset();
+}
+
+PlayerMetrics::Snapshot PlayerMetrics::snapshot() const
+{
+    Snapshot s;
+    for ( int i=0; i<STAGE_COUNT; ++i )
+    {
+        const Histogram& h = m_stages[i];
+        StageStats& stats = s.stages[i];
+        stats.count = h.count.load(std::memory_order_relaxed);
+        stats.totalNs = h.totalNs.load(std::memory_order_relaxed);
+        stats.maxNs = h.maxNs.load(std::memory_order_relaxed);
+        for ( int b=0; b<BUCKETS; ++b ) {
+            stats.buckets[b] = h.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+    for ( int i=0; i<COUNTER_COUNT; ++i ) {
+        s.counters[i] = m_counters[i].load(std::memory_order_relaxed);
+    }
+    s.elapsedMs = static_cast<qint64>( (now() - m_start.load(std::memory_order_relaxed)) / 1000000 );
+    return s;
+}
+
+void PlayerMetrics::reset()
+{
+    for ( int i=0; i<STAGE_COUNT; ++i )
+    {
+        Histogram& h = m_stages[i];
+        h.count.store(0, std::memory_order_relaxed);
+        h.totalNs.store(0, std::memory_order_relaxed);
+        h.maxNs.store(0, std::memory_order_relaxed);
+        for ( int b=0; b<BUCKETS; ++b ) {
+            h.buckets[b].store(0, std::memory_order_relaxed);
+        }
+    }
+    for ( int i=0; i<COUNTER_COUNT; ++i ) {
+        m_counters[i].store(0, std::memory_order_relaxed);
+    }
+    m_start.store(now(), std::memory_order_relaxed);
+    m_lastReport.store(now(), std::memory_order_relaxed);
+}
+
+void PlayerMetrics::setReportInterval(int ms)
+{
+    m_reportIntervalMs.store(ms > 0 ? ms : 0, std::memory_order_relaxed);
+    m_lastReport.store(now(), std::memory_order_relaxed);
+}
+
+bool PlayerMetrics::reportDue()
+{
+    int interval = m_reportIntervalMs.load(std::memory_order_relaxed);
+    if ( interval <= 0 ) {
+        return false;
+    }
+    quint64 t = now();
+    quint64 last = m_lastReport.load(std::memory_order_relaxed);
+    if ( t - last < static_cast<quint64>(interval) * 1000000 ) {
+        return false;
+    }
+    return m_lastReport.compare_exchange_strong(last, t, std::memory_order_relaxed);
+}
+
+const char* PlayerMetrics::stageName(Stage stage)
+{
+    return stage >= 0 && stage < STAGE_COUNT ? STAGE_NAMES[stage] : "";
+}
+
+const char* PlayerMetrics::counterName(Counter counter)
+{
+    return counter >= 0 && counter < COUNTER_COUNT ? COUNTER_NAMES[counter] : "";
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,241 @@
+#ifndef PLAYERMETRICS_H
+#define PLAYERMETRICS_H
+
+/** ***********************************************************************************************
+ * @file PlayerMetrics.h
+ * @brief Latency histograms and counters of the stages of the player loops.
+ *
+ *        Built with VIDEN_ENABLE_METRICS=0 (CMake option VIDEN_ENABLE_METRICS) the VIDEN_METRICS_*
+ *        macros expand to nothing, the players do not read the clock and the snapshots stay empty.
+ */
+
+// Qt
+#include <QtGlobal>
+#include <QMetaType>
+
+#include <atomic>
+#include <chrono>
+
+#ifndef VIDEN_ENABLE_METRICS
+#define VIDEN_ENABLE_METRICS 1
+#endif
+
+
+namespace oscv
+{
+
+/**
+ * @brief The PlayerMetrics class collects the time spent per stage and event counters of a player.
+ *
+ *        A player thread records into its own instance with relaxed atomic operations, there are no
+ *        locks and no allocations on the hot path. Each stage keeps a histogram with power of two
+ *        buckets of nanoseconds, which is enough for percentiles within a factor of two.
+ *        snapshot() can be called from any thread at any time.
+ */
+class PlayerMetrics
+{
+public:
+    enum Stage
+    {
+        Decode = 0, //!< read and decode a frame
+        MutexWait,  //!< wait for the player mutex
+        Process,    //!< per frame processing, e.g. stabilization
+        Wrap,       //!< wrap the frame into the QVariant
+        Emit,       //!< emit newFrame(), includes direct connected slots
+        Sleep,      //!< wait for the next frame
+        STAGE_COUNT
+    };
+
+    enum Counter
+    {
+        Frames = 0,  //!< emitted frames
+        Drops,       //!< frames which took longer than the frame period
+        CacheHits,   //!< frames which were read ahead or taken from a cache
+        CacheMisses, //!< frames which had to be read on demand
+        Skipped,     //!< static frames not emitted, @see ChangeGate
+        COUNTER_COUNT
+    };
+
+    //! Bucket i counts latencies in [2^i, 2^(i+1)) ns, the last bucket everything above ~2 s
+    static const int BUCKETS = 32;
+
+    struct StageStats
+    {
+        quint64 count;
+        quint64 totalNs;
+        quint64 maxNs;
+        quint64 buckets[BUCKETS];
+
+        double meanNs() const;
+
+        /**
+         * @brief percentileNs upper bound of the bucket which contains the given percentile
+         * @param percent 0..100, e.g. 99
+         * @return latency in ns, 0 if nothing was recorded
+         */
+        quint64 percentileNs(double percent) const;
+    };
+
+    struct Snapshot
+    {
+        StageStats stages[STAGE_COUNT];
+        quint64 counters[COUNTER_COUNT];
+        qint64 elapsedMs;   //!< since construction or reset()
+    };
+
+    /**
+     * @brief The ScopedTimer class records the time from construction to destruction into a stage
+     */
+    class ScopedTimer
+    {
+    public:
+        inline ScopedTimer(PlayerMetrics& metrics, Stage stage);
+        inline ~ScopedTimer();
+    private:
+        PlayerMetrics& m_metrics;
+        Stage m_stage;
+        quint64 m_start;
+    };
+
+    PlayerMetrics();
+
+    inline void record(Stage stage, quint64 ns);
+
+    inline void count(Counter counter, quint64 n=1);
+
+    /**
+     * @brief frameDone count an emitted frame, and a drop if it took longer than the frame period
+     * @param startNs now() at the start of the frame
+     * @param periodMs time per frame at the current speed, 0 (Speed::Fast) has no deadline and no drops
+     */
+    inline void frameDone(quint64 startNs, int periodMs);
+
+    Snapshot snapshot() const;
+
+    void reset();
+
+    /**
+     * @brief setReportInterval interval of the metricsUpdated() signal of the players
+     * @param ms 0 (the default) disables the signal
+     */
+    void setReportInterval(int ms);
+
+    inline int reportInterval() const;
+
+    /**
+     * @brief reportDue
+     * @return true once per report interval, called by the player loop
+     */
+    bool reportDue();
+
+    static const char* stageName(Stage stage);
+
+    static const char* counterName(Counter counter);
+
+    //! Monotonic clock in ns
+    static inline quint64 now();
+
+private:
+    struct Histogram
+    {
+        std::atomic<quint64> count;
+        std::atomic<quint64> totalNs;
+        std::atomic<quint64> maxNs;
+        std::atomic<quint64> buckets[BUCKETS];
+    };
+
+    static inline int bucketOf(quint64 ns);
+
+    Histogram m_stages[STAGE_COUNT];
+    std::atomic<quint64> m_counters[COUNTER_COUNT];
+    std::atomic<quint64> m_start;
+    std::atomic<quint64> m_lastReport;
+    std::atomic<int> m_reportIntervalMs;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+PlayerMetrics::ScopedTimer::ScopedTimer(PlayerMetrics& metrics, Stage stage)
+    : m_metrics(metrics)
+    , m_stage(stage)
+    , m_start(PlayerMetrics::now())
+{
+}
+
+PlayerMetrics::ScopedTimer::~ScopedTimer()
+{
+    m_metrics.record(m_stage, PlayerMetrics::now() - m_start);
+}
+
+void PlayerMetrics::record(Stage stage, quint64 ns)
+{
+    Histogram& h = m_stages[stage];
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    h.buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    quint64 max = h.maxNs.load(std::memory_order_relaxed);
+    while ( ns > max && ! h.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed) ) {
+    }
+}
+
+void PlayerMetrics::count(Counter counter, quint64 n)
+{
+    m_counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void PlayerMetrics::frameDone(quint64 startNs, int periodMs)
+{
+    count(Frames);
+    if ( periodMs > 0 && now() - startNs > static_cast<quint64>(periodMs) * 1000000 ) {
+        count(Drops);
+    }
+}
+
+int PlayerMetrics::reportInterval() const
+{
+    return m_reportIntervalMs.load(std::memory_order_relaxed);
+}
+
+quint64 PlayerMetrics::now()
+{
+    return static_cast<quint64>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count() );
+}
+
+int PlayerMetrics::bucketOf(quint64 ns)
+{
+#if defined (__GNUC__)
+    int bucket = 63 - __builtin_clzll(ns | 1);
+#else
+    int bucket = 0;
+    while ( ns >>= 1 ) {
+        ++bucket;
+    }
+#endif
+    return bucket < BUCKETS ? bucket : BUCKETS-1;
+}
+
+}
+
+Q_DECLARE_METATYPE(oscv::PlayerMetrics::Snapshot)
+
+
+#define VIDEN_METRICS_CAT_(a, b) a##b
+#define VIDEN_METRICS_CAT(a, b) VIDEN_METRICS_CAT_(a, b)
+
+#if VIDEN_ENABLE_METRICS
+//! Time the rest of the enclosing scope as the given stage
+#define VIDEN_METRICS_SCOPE(metrics, stage) \
+    oscv::PlayerMetrics::ScopedTimer VIDEN_METRICS_CAT(videnMetricsTimer, __LINE__)(metrics, oscv::PlayerMetrics::stage)
+//! Add one to the given counter
+#define VIDEN_METRICS_COUNT(metrics, counter) (metrics).count(oscv::PlayerMetrics::counter)
+//! Lock the mutex and record the wait as PlayerMetrics::MutexWait
+#define VIDEN_METRICS_LOCK(metrics, mutex) \
+    do { oscv::PlayerMetrics::ScopedTimer videnMetricsLockTimer(metrics, oscv::PlayerMetrics::MutexWait); (mutex).lock(); } while (0)
+#else
+#define VIDEN_METRICS_SCOPE(metrics, stage) ((void)0)
+#define VIDEN_METRICS_COUNT(metrics, counter) ((void)0)
+#define VIDEN_METRICS_LOCK(metrics, mutex) (mutex).lock()
+#endif
+
+#endif // PLAYERMETRICS_H
@@ -0,0 +1,125 @@
+#include "ProcessingStage.h"
+
+// oscv
+#include "Tracer.h"
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+ProcessingStage::ProcessingStage(const Filter& filter, int maxInFlight)
+    : m_filter(filter)
+    , m_maxInFlight(0)
+{
+    setMaxInFlight(maxInFlight);
+}
+
+ProcessingStage::~ProcessingStage()
+{
+    m_tasks.wait();
+}
+
+bool ProcessingStage::push(const cv::Mat& frame, int frameNumber)
+{
+    EntryPtr entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ( static_cast<int>(m_entries.size()) >= m_maxInFlight ) {
+            return false;
+        }
+        if ( m_free.empty() ) {
+            entry = std::make_shared<Entry>();
+        }
+        else {
+            entry = m_free.back();
+            m_free.pop_back();
+        }
+        entry->frameNumber = frameNumber;
+        entry->done = false;
+        entry->ok = false;
+        m_entries.push_back(entry);
+    }
+    frame.copyTo(entry->input); // reuses the buffer of a recycled entry
+    m_tasks.run([this, entry]{ process(entry); });
+    return true;
+}
+
+bool ProcessingStage::pop(cv::Mat& output, int& frameNumber)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while ( ! m_entries.empty() )
+    {
+        EntryPtr entry = m_entries.front();
+        if ( ! entry->done ) {
+            VIDEN_METRICS_SCOPE(m_metrics, MutexWait);
+            VIDEN_TRACE_SCOPE("process_wait");
+            Executor::instance().waitUntil(lock, m_done, [&entry]{ return entry->done; });
+            if ( m_entries.empty() || m_entries.front() != entry ) {
+                continue; // cleared meanwhile
+            }
+        }
+        m_entries.pop_front();
+        if ( entry->ok ) {
+            // the output goes to the caller, it may still be in use when the entry is reused
+            output = entry->output;
+            frameNumber = entry->frameNumber;
+            if ( entry->output.datastart == entry->input.datastart ) {
+                entry->input = cv::Mat(); // the filter passed the input through, copy into a new buffer
+            }
+            entry->output = cv::Mat();
+        }
+        m_free.push_back(entry);
+        if ( entry->ok ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ProcessingStage::isReady() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return ! m_entries.empty() && m_entries.front()->done;
+}
+
+void ProcessingStage::clear()
+{
+    m_tasks.wait();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for ( size_t i=0; i<m_entries.size(); ++i ) {
+        m_entries[i]->output = cv::Mat();
+        m_free.push_back(m_entries[i]);
+    }
+    m_entries.clear();
+}
+
+void ProcessingStage::setMaxInFlight(int frames)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxInFlight = frames > 0 ? frames : 2*Executor::instance().threadCount();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProcessingStage::process(const EntryPtr& entry)
+{
+    bool ok;
+    {
+        VIDEN_METRICS_SCOPE(m_metrics, Process);
+        VIDEN_TRACE_SCOPE("process");
+        ok = m_filter(entry->input, entry->output, entry->frameNumber);
+    }
+#if VIDEN_ENABLE_METRICS
+    m_metrics.count(ok ? PlayerMetrics::Frames : PlayerMetrics::Drops);
+#endif
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry->ok = ok && ! entry->output.empty();
+    entry->done = true;
+    m_done.notify_all();
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
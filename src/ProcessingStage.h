@@ -0,0 +1,158 @@
+#ifndef PROCESSINGSTAGE_H
+#define PROCESSINGSTAGE_H
+
+/** ***********************************************************************************************
+ * @file ProcessingStage.h
+ * @brief Frame parallel processing with in order results, between decoding and emitting frames.
+ */
+
+// oscv
+#include "Executor.h"
+#include "PlayerMetrics.h"
+
+// cv
+#include <opencv2/core/core.hpp>
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The ProcessingStage class runs a filter on several frames at the same time on the Executor
+ *        and hands the results out in the order the frames were pushed.
+ *
+ *        At most maxInFlight() frames are pushed and not popped yet, push() fails when the stage is
+ *        full, pop() the oldest result first. A player loop keeps the stage full:
+ *        @code
+ *        stage.push(frame, frameNumber);
+ *        while ( stage.isFull() || stage.isReady() ) {
+ *            stage.pop(result, resultNumber);
+ *            emit newFrame(...);
+ *        }
+ *        @endcode
+ *        push() and pop() are called by one thread, clear() may be called by another one.
+ *        The filter runs concurrently on different frames, it must not share state between calls
+ *        without locking. metrics() records the filter time as PlayerMetrics::Process, the time pop()
+ *        waited for the oldest frame as PlayerMetrics::MutexWait, filtered frames as Frames and
+ *        frames rejected by the filter as Drops.
+ */
+class ProcessingStage
+{
+public:
+    /**
+     * @brief Filter
+     * @param input decoded frame
+     * @param output[out] result, may share the data of input
+     * @param frameNumber
+     * @return false to drop the frame, pop() skips it
+     */
+    typedef std::function<bool(const cv::Mat& input, cv::Mat& output, int frameNumber)> Filter;
+
+    /**
+     * @brief ProcessingStage
+     * @param filter
+     * @param maxInFlight frames pushed and not popped, 0 for two per executor thread
+     */
+    explicit ProcessingStage(const Filter& filter, int maxInFlight=0);
+
+    //! Waits for the running filters
+    ~ProcessingStage();
+
+    /**
+     * @brief push copy a frame into the stage and start its filter
+     * @param frame the caller may overwrite it afterwards, e.g. with the next decoded frame
+     * @param frameNumber
+     * @return false if isFull()
+     */
+    bool push(const cv::Mat& frame, int frameNumber);
+
+    /**
+     * @brief pop wait for the oldest pushed frame which the filter did not drop
+     * @param output[out] result of the filter
+     * @param frameNumber[out]
+     * @return false if no frame is in flight
+     */
+    bool pop(cv::Mat& output, int& frameNumber);
+
+    //! True if the oldest frame has been filtered, pop() does not wait then
+    bool isReady() const;
+
+    inline bool isFull() const;
+
+    inline int inFlight() const;
+
+    //! Wait for the running filters and drop all frames in flight, e.g. after a seek
+    void clear();
+
+    void setMaxInFlight(int frames);
+
+    inline int maxInFlight() const;
+
+    //! Executor priority class of the filter tasks
+    inline void setPriority(Executor::Priority priority);
+
+    inline PlayerMetrics& metrics();
+
+private:
+    struct Entry
+    {
+        cv::Mat input;
+        cv::Mat output;
+        int frameNumber;
+        bool done;
+        bool ok;
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+
+    ProcessingStage(const ProcessingStage&);
+    ProcessingStage& operator=(const ProcessingStage&);
+
+    void process(const EntryPtr& entry);
+
+    Filter m_filter;
+    int m_maxInFlight;
+    std::deque<EntryPtr> m_entries;   // in push order, popped from the front
+    std::vector<EntryPtr> m_free;     // popped entries, their input buffers are reused
+    mutable std::mutex m_mutex;
+    std::condition_variable m_done;
+    TaskGroup m_tasks;
+    PlayerMetrics m_metrics;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool ProcessingStage::isFull() const
+{
+    return inFlight() >= m_maxInFlight;
+}
+
+int ProcessingStage::inFlight() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<int>(m_entries.size());
+}
+
+int ProcessingStage::maxInFlight() const
+{
+    return m_maxInFlight;
+}
+
+void ProcessingStage::setPriority(Executor::Priority priority)
+{
+    m_tasks.setPriority(priority);
+}
+
+PlayerMetrics& ProcessingStage::metrics()
+{
+    return m_metrics;
+}
+
+}
+#endif // PROCESSINGSTAGE_H
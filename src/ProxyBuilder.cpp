@@ -0,0 +1,289 @@
+#include "ProxyBuilder.h"
+
+// Qt
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QCryptographicHash>
+
+// oscv
+#include "VideoDefs.h"
+#include "Tracer.h"
+
+// cv
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+
+using namespace oscv;
+
+
+namespace
+{
+    const quint32 SOURCE_MAGIC = 0x56505859; // "VPXY"
+    const qint32 SOURCE_VERSION = 1;
+
+    // Identity of a source: absolute path, size and modification time
+    struct SourceId
+    {
+        QString path;
+        qint64 size;
+        qint64 mtime;
+    };
+
+    SourceId sourceId(const QString& source)
+    {
+        QFileInfo info(source);
+        SourceId id;
+        id.path = info.absoluteFilePath();
+        id.size = info.size();
+        id.mtime = info.lastModified().toMSecsSinceEpoch();
+        return id;
+    }
+
+    QString sourceFile(const QString& proxy)
+    {
+        return proxy + ".source";
+    }
+
+    bool writeSourceId(const QString& proxy, const SourceId& id)
+    {
+        QSaveFile file(sourceFile(proxy));
+        if ( ! file.open(QIODevice::WriteOnly) ) {
+            return false;
+        }
+        QDataStream out(&file);
+        out << SOURCE_MAGIC << SOURCE_VERSION << id.path << id.size << id.mtime;
+        return out.status() == QDataStream::Ok && file.commit();
+    }
+
+    bool readSourceId(const QString& proxy, SourceId& id)
+    {
+        QFile file(sourceFile(proxy));
+        if ( ! file.open(QIODevice::ReadOnly) ) {
+            return false;
+        }
+        QDataStream in(&file);
+        quint32 magic;
+        qint32 version;
+        in >> magic >> version;
+        if ( magic != SOURCE_MAGIC || version != SOURCE_VERSION ) {
+            return false;
+        }
+        in >> id.path >> id.size >> id.mtime;
+        return in.status() == QDataStream::Ok;
+    }
+}
+
+
+ProxyBuilder::ProxyBuilder()
+    : m_width(DEFAULT_WIDTH)
+    , m_frameRate(0.0)
+    , m_frameCount(0)
+    , m_written(0)
+    , m_sourceSize(0)
+    , m_sourceMtime(0)
+    , m_state(State::Idle)
+    , m_cancel(false)
+    , m_tasks(Executor::instance(), Executor::Priority::Low)
+{
+}
+
+ProxyBuilder::~ProxyBuilder()
+{
+    cancel();
+    m_tasks.wait();
+}
+
+bool ProxyBuilder::start(const QString& source, const QString& proxy, int width)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if ( m_state == State::Building ) {
+        return false;
+    }
+    m_tasks.wait(); // the handler of the last build may still run
+    if ( ! m_decoder.open(source) ) {
+        return false;
+    }
+    m_source = source;
+    m_proxy = proxy.isEmpty() ? proxyPath(source) : proxy;
+    QFile::remove(sourceFile(m_proxy)); // the old proxy is not valid anymore
+    SourceId id = sourceId(source);   // before transcoding, a change meanwhile makes the proxy stale
+    m_sourceSize = id.size;
+    m_sourceMtime = id.mtime;
+    m_width = width > 0 ? width : DEFAULT_WIDTH;
+    m_frameRate = m_decoder.frameRate();
+    if ( m_frameRate <= 0.0 ) {
+        m_frameRate = VideoDefs::DEFAULT_FRAME_RATE;
+    }
+    m_frameCount = std::max(1, m_decoder.frameCount());
+    m_written = 0;
+    m_size = cv::Size();
+    m_cancel = false;
+    m_state = State::Building;
+    m_tasks.run([this]{ buildChunk(); });
+    return true;
+}
+
+void ProxyBuilder::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cancel = true;
+}
+
+ProxyBuilder::State ProxyBuilder::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Executor::instance().waitUntil(lock, m_finished, [this]{ return m_state != State::Building; });
+    return m_state;
+}
+
+ProxyBuilder::State ProxyBuilder::state() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state;
+}
+
+double ProxyBuilder::progress() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if ( m_state == State::Done ) {
+        return 1.0;
+    }
+    return std::min(1.0, static_cast<double>(m_written) / m_frameCount);
+}
+
+QString ProxyBuilder::source() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_source;
+}
+
+QString ProxyBuilder::proxy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_proxy;
+}
+
+void ProxyBuilder::setFinishedHandler(const FinishedHandler& handler)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finishedHandler = handler;
+}
+
+QString ProxyBuilder::proxyPath(const QString& source, const QString& directory)
+{
+    QFileInfo info(source);
+    if ( directory.isEmpty() || QDir(directory) == info.absoluteDir() ) {
+        return info.absoluteDir().filePath(info.fileName() + ".proxy.avi");
+    }
+    // sources of different directories share this one, the hash of the path tells them apart
+    QByteArray hash = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(), QCryptographicHash::Md5);
+    QString tag = QString::fromLatin1(hash.toHex().left(8));
+    return QDir(directory).filePath(info.fileName() + "." + tag + ".proxy.avi");
+}
+
+bool ProxyBuilder::isUpToDate(const QString& source, const QString& proxy)
+{
+    SourceId built;
+    if ( ! QFileInfo(proxy).exists() || ! QFileInfo(source).exists() || ! readSourceId(proxy, built) ) {
+        return false;
+    }
+    SourceId id = sourceId(source);
+    return built.path == id.path && built.size == id.size && built.mtime == id.mtime;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProxyBuilder::buildChunk()
+{
+    VIDEN_TRACE_SCOPE("proxy_chunk");
+    bool end = false;
+    bool failed = false;
+    int written = 0;
+    for ( int i=0; i<FRAMES_PER_TASK; ++i )
+    {
+        if ( ! m_decoder.read(m_frame) ) {
+            end = true;
+            break;
+        }
+        if ( ! m_writer.isOpened() )
+        {
+            // the size is known with the first frame, MJPEG wants even dimensions
+            int width = std::min(m_width, m_frame.cols) & ~1;
+            int height = cvRound(static_cast<double>(m_frame.rows) * width / m_frame.cols) & ~1;
+            m_size = cv::Size(std::max(2, width), std::max(2, height));
+            if ( ! m_writer.open(temporaryPath(m_proxy).toStdString(), CV_FOURCC('M','J','P','G'),
+                                 m_frameRate, m_size, true) ) {
+                failed = true;
+                break;
+            }
+        }
+        cv::resize(m_frame, m_small, m_size, 0, 0, cv::INTER_AREA);
+        m_writer.write(m_small);
+        written++;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_written += written;
+    if ( m_cancel ) {
+        lock.unlock();
+        finish(State::Cancelled);
+    }
+    else if ( failed || (end && m_written == 0) ) {
+        lock.unlock();
+        finish(State::Failed);
+    }
+    else if ( end ) {
+        lock.unlock();
+        finish(State::Done);
+    }
+    else {
+        m_tasks.run([this]{ buildChunk(); });
+    }
+}
+
+void ProxyBuilder::finish(State state)
+{
+    m_writer.release();
+    m_decoder.close();
+    QString temporary = temporaryPath(m_proxy);
+    if ( state == State::Done ) {
+        SourceId id;
+        id.path = QFileInfo(m_source).absoluteFilePath();
+        id.size = m_sourceSize;
+        id.mtime = m_sourceMtime;
+        QFile::remove(m_proxy);
+        if ( ! QFile::rename(temporary, m_proxy) || ! writeSourceId(m_proxy, id) ) {
+            state = State::Failed;
+        }
+    }
+    if ( state != State::Done ) {
+        QFile::remove(temporary);
+    }
+
+    FinishedHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_state = state;
+        handler = m_finishedHandler;
+        m_finished.notify_all();
+    }
+    if ( handler ) {
+        handler(state);
+    }
+}
+
+QString ProxyBuilder::temporaryPath(const QString& proxy)
+{
+    // keep the extension, the writer chooses the container by it
+    QFileInfo info(proxy);
+    return QDir(info.absolutePath()).filePath(info.completeBaseName() + ".part." + info.suffix());
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
@@ -0,0 +1,146 @@
+#ifndef PROXYBUILDER_H
+#define PROXYBUILDER_H
+
+/** ***********************************************************************************************
+ * @file ProxyBuilder.h
+ * @brief Background transcoding of a video into a small all-intra proxy for fast seeking.
+ */
+
+// Qt
+#include <QString>
+
+// oscv
+#include "VideoDecoder.h"
+#include "Executor.h"
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The ProxyBuilder class transcodes a video into a low resolution MJPEG .avi with the same
+ *        frames and frame rate. Every MJPEG frame is a key frame, so seeking in the proxy takes the
+ *        same time wherever it lands, whatever the GOP length of the source. VideoPlayer shows the
+ *        proxy while scrubbing and playing fast, @see VideoPlayer::setProxyEnabled().
+ *
+ *        The transcoding runs on the Executor in tasks of FRAMES_PER_TASK frames. The proxy is written
+ *        to a temporary file and renamed when it is complete, so a proxy file is never half written.
+ *        The identity of the source is stored with it, isUpToDate() accepts only a proxy of that source.
+ *        @code
+ *        ProxyBuilder builder;
+ *        QString proxy = ProxyBuilder::proxyPath(source);
+ *        if ( ! ProxyBuilder::isUpToDate(source, proxy) ) {
+ *            builder.start(source, proxy);
+ *            ...
+ *            builder.wait();
+ *        }
+ *        @endcode
+ */
+class ProxyBuilder
+{
+public:
+    enum class State { Idle = 0, Building, Done, Failed, Cancelled };
+
+    //! Width of the proxy frames, smaller sources keep their size
+    static const int DEFAULT_WIDTH = 640;
+
+    static const int FRAMES_PER_TASK = 16;
+
+    //! Called on an executor thread when a build has finished, failed or was cancelled
+    typedef std::function<void(State state)> FinishedHandler;
+
+    ProxyBuilder();
+
+    //! Cancels the build and waits for the running task
+    ~ProxyBuilder();
+
+    /**
+     * @brief start transcoding in the background
+     * @param source video file
+     * @param proxy file to create, proxyPath(source) if empty
+     * @param width of the proxy frames, the height keeps the aspect ratio
+     * @return false if a build is running or the source cannot be opened
+     */
+    bool start(const QString& source, const QString& proxy=QString(), int width=DEFAULT_WIDTH);
+
+    //! Stop the build, the partial proxy is removed
+    void cancel();
+
+    //! Wait until the build has ended, @return the final state
+    State wait();
+
+    State state() const;
+
+    //! Fraction of the source frames transcoded, 0..1
+    double progress() const;
+
+    QString source() const;
+
+    QString proxy() const;
+
+    void setFinishedHandler(const FinishedHandler& handler);
+
+    //! Executor priority class of the transcoding, Low by default
+    inline void setPriority(Executor::Priority priority);
+
+    /**
+     * @brief proxyPath default proxy file of a source, e.g. clip.mp4 gives clip.mp4.proxy.avi. In
+     *        another directory a hash of the source path is added, clip.mp4.1a2b3c4d.proxy.avi.
+     * @param source
+     * @param directory of the proxy, the directory of the source if empty
+     */
+    static QString proxyPath(const QString& source, const QString& directory=QString());
+
+    /**
+     * @brief isUpToDate True if the proxy was built from this source as it is now. A finished build
+     *        stores the path, size and modification time of the source next to the proxy (".source").
+     */
+    static bool isUpToDate(const QString& source, const QString& proxy);
+
+private:
+    ProxyBuilder(const ProxyBuilder&);
+    ProxyBuilder& operator=(const ProxyBuilder&);
+
+    //! Transcode the next frames and queue the next task, or finish
+    void buildChunk();
+
+    void finish(State state);
+
+    static QString temporaryPath(const QString& proxy);
+
+    // owned by the one task in flight
+    VideoDecoder m_decoder;
+    cv::VideoWriter m_writer;
+    cv::Mat m_frame;
+    cv::Mat m_small;
+    cv::Size m_size;
+
+    QString m_source;
+    QString m_proxy;
+    int m_width;
+    double m_frameRate;
+    int m_frameCount;
+    int m_written;
+    qint64 m_sourceSize;     // identity of the source when the build started
+    qint64 m_sourceMtime;
+    State m_state;
+    bool m_cancel;
+    FinishedHandler m_finishedHandler;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_finished;
+    TaskGroup m_tasks;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+void ProxyBuilder::setPriority(Executor::Priority priority)
+{
+    m_tasks.setPriority(priority);
+}
+
+}
+#endif // PROXYBUILDER_H
@@ -0,0 +1,193 @@
+#include "RawFrame.h"
+
+// Qt
+#include <QByteArray>
+#include <QDataStream>
+#include <QSaveFile>
+
+// oscv
+#include "LzCodec.h"
+#include "Tracer.h"
+
+#include <vector>
+#include <cstring>
+
+using namespace oscv;
+
+
+const char* const RawFrame::FILE_EXTENSION = ".vraw";
+
+namespace
+{
+    const quint32 RAW_MAGIC = 0x56524157; // "VRAW"
+    const qint32 RAW_VERSION = 1;
+    const int HEADER_SIZE = 64; // fields of the header block, the rest is reserved
+    // LZ writes at least one byte per 255 bytes of output (a length extension byte)
+    const quint64 LZ_MAX_EXPANSION = 255;
+
+    bool isValidType(int type)
+    {
+        return CV_MAT_DEPTH(type) <= CV_64F && CV_MAT_CN(type) >= 1 && CV_MAT_CN(type) <= CV_CN_MAX;
+    }
+}
+
+
+bool RawFrame::write(const QString& filename, const cv::Mat& img, qint64 timestamp, bool compress)
+{
+    if ( img.empty() || img.dims > 2 || img.rows > MAX_SIDE || img.cols > MAX_SIDE ) {
+        return false;
+    }
+    VIDEN_TRACE_SCOPE("raw_write");
+    cv::Mat pixels = img.isContinuous() ? img : img.clone();
+    const size_t rawSize = pixels.total() * pixels.elemSize();
+
+    std::vector<unsigned char> packed;
+    int compression = None;
+    size_t payloadSize = rawSize;
+    if ( compress )
+    {
+        packed.resize(rawSize);
+        size_t size = LzCodec::compress(pixels.data, rawSize, packed.data(), packed.size()); // 0 if not smaller
+        if ( size > 0 ) {
+            compression = Lz;
+            payloadSize = size;
+        }
+    }
+
+    QByteArray header;
+    {
+        QDataStream out(&header, QIODevice::WriteOnly);
+        out << RAW_MAGIC << RAW_VERSION << static_cast<qint32>(PAYLOAD_OFFSET)
+            << static_cast<qint32>(pixels.rows) << static_cast<qint32>(pixels.cols) << static_cast<qint32>(pixels.type())
+            << static_cast<qint32>(compression) << static_cast<quint64>(payloadSize) << static_cast<quint64>(rawSize)
+            << timestamp;
+    }
+    header.append(QByteArray(PAYLOAD_OFFSET - header.size(), '\0'));
+
+    QSaveFile file(filename);
+    if ( ! file.open(QIODevice::WriteOnly) ) {
+        return false;
+    }
+    const char* payload = reinterpret_cast<const char*>(compression == Lz ? packed.data() : pixels.data);
+    return file.write(header) == header.size()
+        && file.write(payload, static_cast<qint64>(payloadSize)) == static_cast<qint64>(payloadSize)
+        && file.commit();
+}
+
+bool RawFrame::read(const QString& filename, cv::Mat& img, qint64* timestamp)
+{
+    VIDEN_TRACE_SCOPE("raw_read");
+    QFile file(filename);
+    // map the whole file, an offset would have to be a multiple of the page size
+    uchar* data = file.open(QIODevice::ReadOnly) ? file.map(0, file.size()) : NULL;
+    if ( data == NULL ) {
+        img.release();
+        return false;
+    }
+    bool ok = decode(data, static_cast<size_t>(file.size()), img, timestamp);
+    file.unmap(data);
+    return ok;
+}
+
+bool RawFrame::decode(const unsigned char* data, size_t size, cv::Mat& img, qint64* timestamp)
+{
+    Header header;
+    if ( ! readHeader(data, size, header) ) {
+        img.release();
+        return false;
+    }
+    img.create(header.rows, header.cols, header.type);
+    const unsigned char* payload = data + PAYLOAD_OFFSET;
+    bool ok = true;
+    if ( header.compression == None ) {
+        std::memcpy(img.data, payload, header.rawSize);
+    }
+    else {
+        ok = LzCodec::decompress(payload, header.payloadSize, img.data, header.rawSize);
+    }
+    if ( ! ok ) {
+        img.release();
+        return false;
+    }
+    if ( timestamp ) {
+        *timestamp = header.timestamp;
+    }
+    return true;
+}
+
+bool RawFrame::readHeader(const unsigned char* data, size_t size, Header& header)
+{
+    if ( data == NULL || size < static_cast<size_t>(PAYLOAD_OFFSET) ) {
+        return false;
+    }
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(data), HEADER_SIZE);
+    QDataStream in(bytes);
+    quint32 magic;
+    qint32 version, offset, rows, cols, type, compression;
+    in >> magic >> version >> offset;
+    if ( magic != RAW_MAGIC || version != RAW_VERSION || offset != PAYLOAD_OFFSET ) {
+        return false;
+    }
+    in >> rows >> cols >> type >> compression >> header.payloadSize >> header.rawSize >> header.timestamp;
+    if ( in.status() != QDataStream::Ok || rows <= 0 || cols <= 0 || rows > MAX_SIDE || cols > MAX_SIDE
+         || ! isValidType(type)
+         || (compression != None && compression != Lz) ) {
+        return false;
+    }
+    header.rows = rows;
+    header.cols = cols;
+    header.type = type;
+    header.compression = compression;
+
+    const quint64 expected = static_cast<quint64>(rows) * static_cast<quint64>(cols) * CV_ELEM_SIZE(type);
+    // the payload must be able to produce rawSize, so a corrupt header cannot make decode() allocate more
+    return header.rawSize == expected
+        && header.payloadSize <= size - PAYLOAD_OFFSET
+        && (compression == Lz ? header.rawSize <= header.payloadSize * LZ_MAX_EXPANSION
+                              : header.payloadSize == header.rawSize);
+}
+
+
+MappedFrame::MappedFrame()
+    : m_map(NULL)
+    , m_timestamp(0)
+{
+}
+
+MappedFrame::~MappedFrame()
+{
+    close();
+}
+
+bool MappedFrame::open(const QString& filename)
+{
+    close();
+    m_file.setFileName(filename);
+    if ( ! m_file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    m_map = m_file.map(0, m_file.size());
+    RawFrame::Header header;
+    if ( m_map == NULL
+         || ! RawFrame::readHeader(m_map, static_cast<size_t>(m_file.size()), header)
+         || header.compression != RawFrame::None ) {
+        close();
+        return false;
+    }
+    m_mat = cv::Mat(header.rows, header.cols, header.type, m_map + RawFrame::PAYLOAD_OFFSET);
+    m_timestamp = header.timestamp;
+    return true;
+}
+
+void MappedFrame::close()
+{
+    m_mat = cv::Mat();
+    m_timestamp = 0;
+    if ( m_map ) {
+        m_file.unmap(m_map);
+        m_map = NULL;
+    }
+    m_file.close();
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
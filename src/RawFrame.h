@@ -0,0 +1,157 @@
+#ifndef RAWFRAME_H
+#define RAWFRAME_H
+
+/** ***********************************************************************************************
+ * @file RawFrame.h
+ * @brief Native .vraw frame files: a small header and the pixels, optionally LZ compressed.
+ */
+
+// Qt
+#include <QString>
+#include <QFile>
+
+// cv
+#include <opencv2/core/core.hpp>
+
+#include <cstddef>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The RawFrame class reads and writes the .vraw scratch format for intermediate frames.
+ *
+ *        The file starts with a header block of PAYLOAD_OFFSET bytes: magic "VRAW", version,
+ *        rows, cols, cv type, compression, payload and raw size and a timestamp in ms. The pixels
+ *        follow at PAYLOAD_OFFSET, so the payload of a mapped file is page aligned. Any depth and
+ *        channel count of cv::Mat is stored as is, 16 bit and float frames included.
+ *
+ *        Without compression read() is one memcpy out of the mapped file, MappedFrame avoids even
+ *        that. The LZ compression (@see LzCodec) is lossless and fast, worth it for masks and
+ *        synthetic images; write() stores the pixels uncompressed if LZ does not make them smaller.
+ */
+class RawFrame
+{
+public:
+    enum Compression
+    {
+        None = 0,
+        Lz = 1
+    };
+
+    //! File extension with dot
+    static const char* const FILE_EXTENSION;
+
+    //! The header block is padded to this size, the payload starts here
+    static const int PAYLOAD_OFFSET = 4096;
+
+    //! Largest number of rows and of cols of a frame file
+    static const int MAX_SIDE = 1 << 16;
+
+    struct Header
+    {
+        int rows;
+        int cols;
+        int type;
+        int compression;
+        quint64 payloadSize;
+        quint64 rawSize;
+        qint64 timestamp;
+    };
+
+    /**
+     * @brief write store an image
+     * @param filename
+     * @param img any type, a non continuous image (ROI) is copied first
+     * @param timestamp ms, e.g. the position of the frame in the video
+     * @param compress try LZ compression
+     * @return false if img is empty, larger than MAX_SIDE or the file cannot be written
+     */
+    static bool write(const QString& filename, const cv::Mat& img, qint64 timestamp=0, bool compress=false);
+
+    /**
+     * @brief read a file into a new image which owns its data, like cv::imread
+     * @param timestamp[out] may be null
+     * @return false if the file cannot be read or is not a valid .vraw file, img is empty then
+     */
+    static bool read(const QString& filename, cv::Mat& img, qint64* timestamp=NULL);
+
+    /**
+     * @brief decode a file which is already in memory, e.g. from the read-ahead of an image sequence
+     * @param data the whole file
+     * @param size bytes of data
+     * @param img[out] its buffer is reused if the size and type match
+     */
+    static bool decode(const unsigned char* data, size_t size, cv::Mat& img, qint64* timestamp=NULL);
+
+    /**
+     * @brief readHeader parse and check the header block. The sides must not exceed MAX_SIDE and the
+     *        payload must be large enough for the image, so a corrupt file cannot cause a huge allocation.
+     * @param size bytes of the whole file, the payload must fit into it
+     */
+    static bool readHeader(const unsigned char* data, size_t size, Header& header);
+
+private:
+    RawFrame();
+};
+
+
+/**
+ * @brief The MappedFrame class maps an uncompressed .vraw file and gives a cv::Mat header on the
+ *        mapped pixels, no copy and no decoding. The pages are loaded by the OS when they are touched.
+ *
+ *        The image is valid until close() or the destruction of the MappedFrame, it is read only:
+ *        clone() it to keep or modify it. Compressed files cannot be mapped, use RawFrame::read().
+ */
+class MappedFrame
+{
+public:
+    MappedFrame();
+
+    ~MappedFrame();
+
+    /**
+     * @brief open map a file
+     * @return false if the file cannot be mapped, is not a valid .vraw file or is compressed
+     */
+    bool open(const QString& filename);
+
+    void close();
+
+    inline bool isOpen() const;
+
+    //! Header on the mapped pixels, empty if not open
+    inline const cv::Mat& mat() const;
+
+    inline qint64 timestamp() const;
+
+private:
+    MappedFrame(const MappedFrame&);
+    MappedFrame& operator=(const MappedFrame&);
+
+    QFile m_file;
+    uchar* m_map;
+    cv::Mat m_mat;
+    qint64 m_timestamp;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool MappedFrame::isOpen() const
+{
+    return m_map != NULL;
+}
+
+const cv::Mat& MappedFrame::mat() const
+{
+    return m_mat;
+}
+
+qint64 MappedFrame::timestamp() const
+{
+    return m_timestamp;
+}
+
+}
+#endif // RAWFRAME_H
@@ -0,0 +1,350 @@
+#include "SequenceIndex.h"
+
+// Qt
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+// oscv
+#include "FileUtils.h"
+#include "VideoDefs.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined (__linux__)  || defined (__unix__)
+#include <dirent.h>
+#endif
+
+using namespace oscv;
+
+
+QMutex SequenceIndex::s_mutex;
+QCache<QString, SequenceIndex> SequenceIndex::s_cache(SequenceIndex::DEFAULT_CACHE_CAPACITY);
+QString SequenceIndex::s_cacheDir;
+
+namespace
+{
+    const quint32 CACHE_MAGIC = 0x56534958; // "VSIX"
+    const qint32 CACHE_VERSION = 1;
+
+    // A directory which was modified this short before it was read may have changed again
+    // within the same modification time stamp. Such an index is not taken from the cache.
+    const qint64 MTIME_GRANULARITY_MS = 2000;
+
+    inline bool isDigit(QChar c)
+    {
+        return c.unicode() >= '0' && c.unicode() <= '9';
+    }
+}
+
+
+SequenceIndex::SequenceIndex()
+    : m_digits(0)
+    , m_mtime(0)
+    , m_scanTime(0)
+{
+}
+
+bool SequenceIndex::open(const QString& filename)
+{
+    clear();
+    QFileInfo file(filename);
+    int number;
+    if ( ! parseName(file.fileName(), m_prefix, number, m_digits, m_ext) ) {
+        return false;
+    }
+    m_dir = file.absolutePath();
+    getPathWithSeparator(m_dir);
+
+    qint64 mtime = QFileInfo(m_dir).lastModified().toMSecsSinceEpoch();
+    if ( load(mtime) ) {
+        return true;
+    }
+    m_mtime = mtime;
+    if ( ! scan() ) {
+        clear();
+        return false;
+    }
+    save();
+    return true;
+}
+
+bool SequenceIndex::rescan()
+{
+    if ( m_dir.isEmpty() ) {
+        return false;
+    }
+    m_mtime = QFileInfo(m_dir).lastModified().toMSecsSinceEpoch();
+    if ( ! scan() ) {
+        clear();
+        return false;
+    }
+    save();
+    return true;
+}
+
+void SequenceIndex::clear()
+{
+    m_dir.clear();
+    m_prefix.clear();
+    m_ext.clear();
+    m_digits = 0;
+    m_mtime = 0;
+    m_scanTime = 0;
+    m_numbers.clear();
+}
+
+QString SequenceIndex::path(int index) const
+{
+    if ( index < 0 || index >= size() ) {
+        return QString();
+    }
+    QString name(m_dir);
+    name.append(m_prefix).append( QString::number(m_numbers[index]).rightJustified(m_digits, '0') );
+    if ( ! m_ext.isEmpty() ) {
+        name.append(".").append(m_ext);
+    }
+    return name;
+}
+
+int SequenceIndex::indexOf(int number) const
+{
+    std::vector<int>::const_iterator it = std::lower_bound(m_numbers.begin(), m_numbers.end(), number);
+    if ( it == m_numbers.end() || *it != number ) {
+        return VideoDefs::INVALID_FRAME_NUMBER;
+    }
+    return static_cast<int>(it - m_numbers.begin());
+}
+
+int SequenceIndex::insert(int number)
+{
+    if ( m_numbers.empty() || number > m_numbers.back() ) {
+        m_numbers.push_back(number);
+        return size()-1;
+    }
+    std::vector<int>::iterator it = std::lower_bound(m_numbers.begin(), m_numbers.end(), number);
+    if ( *it == number ) {
+        return VideoDefs::INVALID_FRAME_NUMBER;
+    }
+    return static_cast<int>( m_numbers.insert(it, number) - m_numbers.begin() );
+}
+
+bool SequenceIndex::matches(const QString& fileName, int& number) const
+{
+    int extLen = m_ext.isEmpty()? 0 : m_ext.size()+1;
+    int digits = fileName.size() - m_prefix.size() - extLen;
+    // longer numbers than the format are allowed if they are not zero padded, e.g. img_10000 after img_9999
+    if ( digits < m_digits || digits > 9 || ! fileName.startsWith(m_prefix) ) {
+        return false;
+    }
+    if ( extLen && ( ! fileName.endsWith(m_ext) || fileName.at(fileName.size()-extLen) != '.' ) ) {
+        return false;
+    }
+    int start = m_prefix.size();
+    if ( digits > m_digits && fileName.at(start) == '0' ) {
+        return false;
+    }
+    number = 0;
+    for ( int i=start; i<start+digits; ++i ) {
+        QChar c = fileName.at(i);
+        if ( ! isDigit(c) ) {
+            return false;
+        }
+        number = number*10 + (c.unicode() - '0');
+    }
+    return true;
+}
+
+bool SequenceIndex::parseName(const QString& fileName, QString& prefix, int& number, int& digits, QString& extension)
+{
+    int dot = fileName.lastIndexOf('.');
+    if ( dot < 0 ) {
+        dot = fileName.size();
+    }
+    int start = dot;
+    while ( start > 0 && isDigit(fileName.at(start-1)) ) {
+        --start;
+    }
+    digits = dot - start;
+    if ( digits == 0 || digits > 9 ) {
+        return false;
+    }
+    prefix = fileName.left(start);
+    extension = fileName.mid(dot+1);
+    number = fileName.mid(start, digits).toInt();
+    return true;
+}
+
+void SequenceIndex::setCacheDirectory(const QString& dir)
+{
+    QMutexLocker locker(&s_mutex);
+    s_cacheDir = dir;
+}
+
+void SequenceIndex::setCacheCapacity(int frames)
+{
+    QMutexLocker locker(&s_mutex);
+    s_cache.setMaxCost(std::max(0, frames));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One pass over the directory entries, no stat per file
+bool SequenceIndex::scan()
+{
+    m_numbers.clear();
+    m_scanTime = QDateTime::currentMSecsSinceEpoch();
+    int number;
+
+#if defined (__linux__)  || defined (__unix__)
+    DIR* dir = opendir( QFile::encodeName(m_dir).constData() );
+    if ( dir == NULL ) {
+        return false;
+    }
+    QByteArray prefix = QFile::encodeName(m_prefix);
+    struct dirent* entry;
+    while ( (entry = readdir(dir)) != NULL ) {
+        // cheap byte compare before decoding the name
+        if ( std::strncmp(entry->d_name, prefix.constData(), prefix.size()) != 0 ) {
+            continue;
+        }
+#ifdef _DIRENT_HAVE_D_TYPE
+        if ( entry->d_type == DT_DIR ) {
+            continue;
+        }
+#endif
+        if ( matches(QFile::decodeName(entry->d_name), number) ) {
+            m_numbers.push_back(number);
+        }
+    }
+    closedir(dir);
+#else
+    QDir dir(m_dir);
+    if ( ! dir.exists() ) {
+        return false;
+    }
+    QStringList names = dir.entryList(QStringList() << m_prefix + "*", QDir::Files, QDir::NoSort);
+    for ( const QString& name: names ) {
+        if ( matches(name, number) ) {
+            m_numbers.push_back(number);
+        }
+    }
+#endif
+
+    std::sort(m_numbers.begin(), m_numbers.end());
+    m_numbers.erase( std::unique(m_numbers.begin(), m_numbers.end()), m_numbers.end() );
+    return true;
+}
+
+QString SequenceIndex::cacheKey() const
+{
+    return QString("%1%2*%3.%4").arg(m_dir).arg(m_prefix).arg(m_digits).arg(m_ext);
+}
+
+QString SequenceIndex::cacheFileName() const
+{
+    QByteArray hash = QCryptographicHash::hash(cacheKey().toUtf8(), QCryptographicHash::Md5).toHex();
+    QString name(s_cacheDir);
+    getPathWithSeparator(name);
+    return name.append(QString::fromLatin1(hash)).append(".seqidx");
+}
+
+// Cost of the index in the process cache, the frames and one for the entry itself
+int SequenceIndex::cacheCost() const
+{
+    return static_cast<int>(m_numbers.size()) + 1;
+}
+
+// Take the index from the process cache or the disk cache if the directory has not changed
+bool SequenceIndex::load(qint64 mtime)
+{
+    QString key = cacheKey();
+    QString fileName;
+    {
+        QMutexLocker locker(&s_mutex);
+        const SequenceIndex* cached = s_cache.object(key); // marks it as recently used
+        if ( cached && cached->m_mtime == mtime ) {
+            *this = *cached;
+            return true;
+        }
+        if ( s_cacheDir.isEmpty() ) {
+            return false;
+        }
+        fileName = cacheFileName();
+    }
+
+    QFile file(fileName);
+    if ( ! file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QDataStream in(&file);
+    quint32 magic;
+    qint32 version, digits;
+    QString fileKey;
+    qint64 fileMtime, scanTime;
+    quint32 count;
+    in >> magic >> version;
+    if ( magic != CACHE_MAGIC || version != CACHE_VERSION ) {
+        return false;
+    }
+    in >> fileKey >> fileMtime >> scanTime >> digits >> count;
+    if ( in.status() != QDataStream::Ok || fileKey != key || fileMtime != mtime || digits != m_digits
+         || count > file.size() / 4 ) { // 4 bytes per frame, a corrupt count must not allocate
+        return false;
+    }
+    m_numbers.resize(count);
+    for ( quint32 i=0; i<count; ++i ) {
+        qint32 n;
+        in >> n;
+        m_numbers[i] = n;
+    }
+    if ( in.status() != QDataStream::Ok ) {
+        m_numbers.clear();
+        return false;
+    }
+    m_mtime = fileMtime;
+    m_scanTime = scanTime;
+
+    QMutexLocker locker(&s_mutex);
+    s_cache.insert(key, new SequenceIndex(*this), cacheCost());
+    return true;
+}
+
+void SequenceIndex::save() const
+{
+    if ( m_scanTime - m_mtime < MTIME_GRANULARITY_MS ) {
+        return; // the directory may still be changing, see MTIME_GRANULARITY_MS
+    }
+    QString key = cacheKey();
+    QString fileName;
+    {
+        QMutexLocker locker(&s_mutex);
+        s_cache.insert(key, new SequenceIndex(*this), cacheCost());
+        if ( s_cacheDir.isEmpty() ) {
+            return;
+        }
+        fileName = cacheFileName();
+    }
+
+    QSaveFile file(fileName);
+    if ( ! file.open(QIODevice::WriteOnly) ) {
+        return;
+    }
+    QDataStream out(&file);
+    out << CACHE_MAGIC << CACHE_VERSION << key << m_mtime << m_scanTime
+        << static_cast<qint32>(m_digits) << static_cast<quint32>(m_numbers.size());
+    for ( size_t i=0; i<m_numbers.size(); ++i ) {
+        out << static_cast<qint32>(m_numbers[i]);
+    }
+    file.commit();
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
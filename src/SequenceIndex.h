@@ -0,0 +1,193 @@
+#ifndef SEQUENCEINDEX_H
+#define SEQUENCEINDEX_H
+
+/** ***********************************************************************************************
+ * @file SequenceIndex.h
+ * @brief Index of the frames of an image sequence in one directory, e.g. img_0000.png ... img_0199.png
+ */
+
+// Qt
+#include <QString>
+#include <QCache>
+#include <QMutex>
+
+#include <vector>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The SequenceIndex class lists the frames of an image sequence with one pass over the directory.
+ *
+ *        A sequence is given by one of its files: the name is split into prefix, number and extension
+ *        (img_0042.png gives "img_", 42 with 4 digits and "png"). All files of the directory with the same
+ *        prefix, extension and number format belong to the sequence, gaps in the numbering are kept.
+ *        The index maps the position in the sequence (0..size()-1) to the file in O(1).
+ *
+ *        Built indices are cached per process, keyed by the directory and its modification time, up to
+ *        a total of cacheCapacity frames (the least recently used are dropped first), and
+ *        optionally on disk (@see setCacheDirectory), so opening the same sequence again does not
+ *        read the directory.
+ */
+class SequenceIndex
+{
+public:
+    SequenceIndex();
+
+    /**
+     * @brief open index the sequence the given file belongs to.
+     * @param filename any file of the sequence with path
+     * @return false if the name has no number before the extension or the directory cannot be read.
+     */
+    bool open(const QString& filename);
+
+    /**
+     * @brief rescan read the directory of the opened sequence again, the caches are bypassed and updated.
+     * @return false if nothing is open or the directory cannot be read, the index is empty then.
+     */
+    bool rescan();
+
+    /**
+     * @brief clear empty the index
+     */
+    void clear();
+
+    /**
+     * @brief path full path of the frame at the given position
+     * @param index position in the sequence, 0..size()-1
+     * @return path or empty string if index is out of range
+     */
+    QString path(int index) const;
+
+    /**
+     * @brief indexOf position of the file with the given number
+     * @param number number in the file name
+     * @return position or VideoDefs::INVALID_FRAME_NUMBER if the sequence has no such file
+     */
+    int indexOf(int number) const;
+
+    /**
+     * @brief insert add a file to the sequence, e.g. a file which has been written after the index
+     *        was built. Adding behind the last number is O(1). The in-process cache is not updated.
+     * @param number number in the file name
+     * @return position of the new file or VideoDefs::INVALID_FRAME_NUMBER if it is already indexed
+     */
+    int insert(int number);
+
+    /**
+     * @brief matches check if a file name (without path) belongs to this sequence
+     * @param fileName name of the file
+     * @param number[out] number in the file name
+     * @return true if prefix, number format and extension match
+     */
+    bool matches(const QString& fileName, int& number) const;
+
+    inline int size() const;
+
+    inline bool isEmpty() const;
+
+    //! Number in the file name of the frame at the given position
+    inline int number(int index) const;
+
+    inline const QString& directory() const;
+
+    inline const QString& prefix() const;
+
+    inline const QString& extension() const;
+
+    inline int digits() const;
+
+    /**
+     * @brief parseName split a file name into prefix, number and extension
+     * @param fileName e.g. img_0042.png
+     * @param prefix[out] e.g. img_
+     * @param number[out] e.g. 42
+     * @param digits[out] number of digits, e.g. 4
+     * @param extension[out] e.g. png
+     * @return false if there are no digits directly before the extension
+     */
+    static bool parseName(const QString& fileName, QString& prefix, int& number, int& digits, QString& extension);
+
+    /**
+     * @brief setCacheDirectory store built indices in this directory so that they survive the process.
+     * @param dir existing, writable directory. Empty (the default) disables the disk cache.
+     */
+    static void setCacheDirectory(const QString& dir);
+
+    //! Default limit of the process cache, 4M frames take about 16 MB
+    static const int DEFAULT_CACHE_CAPACITY = 1 << 22;
+
+    /**
+     * @brief setCacheCapacity limit of the process cache in frames of all cached indices. When it is
+     *        exceeded the least recently used indices are dropped. 0 disables the process cache.
+     */
+    static void setCacheCapacity(int frames);
+
+
+private:
+    bool scan();
+
+    QString cacheKey() const;
+
+    QString cacheFileName() const;
+
+    bool load(qint64 mtime);
+
+    void save() const;
+
+    int cacheCost() const;
+
+
+    QString m_dir;        // with file separator
+    QString m_prefix;
+    QString m_ext;
+    int m_digits;
+    qint64 m_mtime;       // modification time of the directory when it was read, ms since epoch
+    qint64 m_scanTime;    // time of reading the directory, ms since epoch
+    std::vector<int> m_numbers;
+
+    static QMutex s_mutex;
+    static QCache<QString, SequenceIndex> s_cache;   // guarded by s_mutex
+    static QString s_cacheDir;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+int SequenceIndex::size() const
+{
+    return static_cast<int>(m_numbers.size());
+}
+
+bool SequenceIndex::isEmpty() const
+{
+    return m_numbers.empty();
+}
+
+int SequenceIndex::number(int index) const
+{
+    return m_numbers[index];
+}
+
+const QString& SequenceIndex::directory() const
+{
+    return m_dir;
+}
+
+const QString& SequenceIndex::prefix() const
+{
+    return m_prefix;
+}
+
+const QString& SequenceIndex::extension() const
+{
+    return m_ext;
+}
+
+int SequenceIndex::digits() const
+{
+    return m_digits;
+}
+
+}
+#endif // SEQUENCEINDEX_H
@@ -0,0 +1,142 @@
+#include "SequenceWatcher.h"
+
+// Qt
+#include <QFile>
+
+#if defined (__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+using namespace oscv;
+
+
+SequenceWatcher::SequenceWatcher(QObject *parent)
+    : QThread(parent)
+    , m_inotifyFd(-1)
+    , m_watching(false)
+{
+    m_wakeFd[0] = m_wakeFd[1] = -1;
+}
+
+SequenceWatcher::~SequenceWatcher()
+{
+    unwatch();
+}
+
+bool SequenceWatcher::isSupported()
+{
+#if defined (__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SequenceWatcher::watch(const SequenceIndex& sequence)
+{
+    unwatch();
+#if defined (__linux__)
+    m_sequence = sequence;
+    m_inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if ( m_inotifyFd < 0 ) {
+        return false;
+    }
+    // IN_CLOSE_WRITE: the writer is done with the file, IN_MOVED_TO: written elsewhere and renamed
+    if ( inotify_add_watch(m_inotifyFd, QFile::encodeName(sequence.directory()).constData(),
+                           IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0
+         || pipe2(m_wakeFd, O_CLOEXEC | O_NONBLOCK) < 0 )
+    {
+        unwatch();
+        return false;
+    }
+    m_watching = true;
+    start(LowPriority);
+    return true;
+#else
+    Q_UNUSED(sequence);
+    return false;
+#endif
+}
+
+void SequenceWatcher::unwatch()
+{
+#if defined (__linux__)
+    if ( m_wakeFd[1] >= 0 ) {
+        char c = 0;
+        ssize_t n = write(m_wakeFd[1], &c, 1);
+        Q_UNUSED(n);
+    }
+    wait();
+    if ( m_inotifyFd >= 0 ) {
+        close(m_inotifyFd);
+    }
+    for ( int i=0; i<2; ++i ) {
+        if ( m_wakeFd[i] >= 0 ) {
+            close(m_wakeFd[i]);
+        }
+    }
+#endif
+    m_inotifyFd = -1;
+    m_wakeFd[0] = m_wakeFd[1] = -1;
+    m_watching = false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Protected
+///
+
+void SequenceWatcher::run()
+{
+#if defined (__linux__)
+    alignas(struct inotify_event) char buffer[16*1024];
+    struct pollfd fds[2];
+    fds[0].fd = m_inotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeFd[0];
+    fds[1].events = POLLIN;
+
+    while ( true )
+    {
+        fds[0].revents = fds[1].revents = 0;
+        if ( poll(fds, 2, -1) < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            break;
+        }
+        if ( fds[1].revents != 0 || (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) ) {
+            break;
+        }
+
+        ssize_t len;
+        while ( (len = read(m_inotifyFd, buffer, sizeof(buffer))) > 0 )
+        {
+            for ( char* p = buffer; p < buffer + len; )
+            {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + event->len;
+                if ( event->mask & IN_Q_OVERFLOW ) {
+                    emit eventsLost();
+                    continue;
+                }
+                int number;
+                if ( event->len > 0 && ! (event->mask & IN_ISDIR)
+                     && m_sequence.matches(QFile::decodeName(event->name), number) )
+                {
+                    emit fileAdded(number);
+                }
+            }
+        }
+    }
+#endif
+    m_watching = false;
+}
+
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,86 @@
+#ifndef SEQUENCEWATCHER_H
+#define SEQUENCEWATCHER_H
+
+/** ***********************************************************************************************
+ * @file SequenceWatcher.h
+ * @brief Notification about new files of an image sequence which is still being written.
+ */
+
+// Qt
+#include <QThread>
+#include <QObject>
+
+// oscv
+#include "SequenceIndex.h"
+
+#include <atomic>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The SequenceWatcher class watches the directory of a sequence with inotify (Linux only).
+ *
+ *        The thread blocks in poll() until the kernel reports a file which has been closed after
+ *        writing or moved into the directory. There is no polling and no directory scan.
+ *        Signals are emitted from the watcher thread, connect with Qt::DirectConnection to handle
+ *        them without an event loop.
+ */
+class SequenceWatcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    SequenceWatcher(QObject *parent = 0);
+
+    ~SequenceWatcher();
+
+    /**
+     * @brief watch start watching the directory of the sequence. A running watch is stopped first.
+     * @param sequence index which gives directory, prefix, number format and extension
+     * @return false if inotify is not available or the directory cannot be watched.
+     */
+    bool watch(const SequenceIndex& sequence);
+
+    /**
+     * @brief unwatch stop watching and wait for the thread
+     */
+    void unwatch();
+
+    inline bool isWatching() const;
+
+    /**
+     * @brief isSupported
+     * @return true if the platform has inotify
+     */
+    static bool isSupported();
+
+signals:
+
+    //! A complete file of the sequence with the given number appeared
+    void fileAdded(int number);
+
+    //! The kernel event queue overflowed, files may have been missed
+    void eventsLost();
+
+protected:
+
+    void run();
+
+private:
+    SequenceIndex m_sequence; // only used to match the file names
+    int m_inotifyFd;
+    int m_wakeFd[2];          // pipe to wake the thread up from poll()
+    std::atomic<bool> m_watching;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool SequenceWatcher::isWatching() const
+{
+    return m_watching;
+}
+
+}
+#endif // SEQUENCEWATCHER_H
@@ -0,0 +1,311 @@
+#include "TilePyramid.h"
+
+// oscv
+#include "Executor.h"
+#include "Tracer.h"
+
+// cv
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace oscv;
+
+
+namespace
+{
+    inline int levelOf(quint64 key)
+    {
+        return static_cast<int>(key >> 56);
+    }
+
+    inline int columnOf(quint64 key)
+    {
+        return static_cast<int>((key >> 28) & 0x0FFFFFFF);
+    }
+
+    inline int rowOf(quint64 key)
+    {
+        return static_cast<int>(key & 0x0FFFFFFF);
+    }
+}
+
+
+TilePyramid::TilePyramid(int tileSize, size_t budgetBytes)
+    : m_tileSize(16)
+    , m_tileShift(4)
+    , m_budget(budgetBytes)
+    , m_levels(0)
+    , m_generation(0)
+    , m_computed(0)
+    , m_bytes(0)
+{
+    // a power of two, so the children of a tile halve exactly
+    while ( m_tileSize < tileSize && m_tileShift < 14 ) {
+        m_tileSize <<= 1;
+        m_tileShift++;
+    }
+}
+
+void TilePyramid::setImage(const cv::Mat& image)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+    m_bytes = 0;
+    m_computed = 0;
+    m_generation++;
+    m_image = image;
+    m_levels = 0;
+    if ( image.empty() ) {
+        return;
+    }
+    m_levels = 1;
+    for ( cv::Size size = image.size(); size.width > m_tileSize || size.height > m_tileSize; ) {
+        size = levelSizeOf(image.size(), m_levels);
+        m_levels++;
+    }
+}
+
+void TilePyramid::clear()
+{
+    setImage(cv::Mat());
+}
+
+int TilePyramid::levelFor(double zoom) const
+{
+    int levels = TilePyramid::levels();
+    if ( zoom >= 1.0 || levels == 0 ) {
+        return 0;
+    }
+    int level = zoom > 0.0 ? static_cast<int>(std::floor(std::log(1.0 / zoom) / std::log(2.0) + 1e-9)) : levels-1;
+    return std::min(std::max(level, 0), levels-1);
+}
+
+std::vector<TilePyramid::Tile> TilePyramid::request(const cv::Rect& viewport, double zoom)
+{
+    std::vector<Tile> result;
+    cv::Mat image;
+    quint64 generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        image = m_image;
+        generation = m_generation;
+    }
+    cv::Rect visible = viewport & cv::Rect(0, 0, image.cols, image.rows);
+    if ( image.empty() || visible.area() == 0 ) {
+        return result;
+    }
+    VIDEN_TRACE_SCOPE("tile_request");
+
+    const int level = levelFor(zoom);
+    const int span = m_tileSize << level; // image pixels per tile
+    const int x0 = visible.x / span;
+    const int x1 = (visible.x + visible.width - 1) / span;
+    const int y0 = visible.y / span;
+    const int y1 = (visible.y + visible.height - 1) / span;
+
+    std::vector<Key> keys;
+    for ( int y=y0; y<=y1; ++y ) {
+        for ( int x=x0; x<=x1; ++x ) {
+            keys.push_back( makeKey(level, x, y) );
+        }
+    }
+    std::vector<cv::Mat> tiles = produce(keys, image, generation);
+
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+    for ( size_t i=0; i<keys.size(); ++i )
+    {
+        Tile t;
+        t.level = level;
+        t.x = columnOf(keys[i]);
+        t.y = rowOf(keys[i]);
+        t.rect = cv::Rect(t.x * span, t.y * span, span, span) & bounds;
+        t.image = tiles[i];
+        result.push_back(t);
+    }
+    return result;
+}
+
+cv::Mat TilePyramid::tile(int level, int x, int y)
+{
+    cv::Mat image;
+    quint64 generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        image = m_image;
+        generation = m_generation;
+        if ( image.empty() || level < 0 || level >= m_levels ) {
+            return cv::Mat();
+        }
+    }
+    cv::Size size = levelSizeOf(image.size(), level);
+    if ( x < 0 || y < 0 || x * m_tileSize >= size.width || y * m_tileSize >= size.height ) {
+        return cv::Mat();
+    }
+    return produce(std::vector<Key>(1, makeKey(level, x, y)), image, generation)[0];
+}
+
+int TilePyramid::levels() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_levels;
+}
+
+cv::Size TilePyramid::levelSize(int level) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return level >= 0 && level < m_levels ? levelSizeOf(m_image.size(), level) : cv::Size();
+}
+
+int TilePyramid::columns(int level) const
+{
+    return (levelSize(level).width + m_tileSize - 1) >> m_tileShift;
+}
+
+int TilePyramid::rows(int level) const
+{
+    return (levelSize(level).height + m_tileSize - 1) >> m_tileShift;
+}
+
+void TilePyramid::setBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = budgetBytes;
+    evict();
+}
+
+size_t TilePyramid::cachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<cv::Mat> TilePyramid::produce(const std::vector<Key>& keys, const cv::Mat& image, quint64 generation)
+{
+    std::vector<cv::Mat> tiles(keys.size());
+    std::vector<size_t> missing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for ( size_t i=0; i<keys.size(); ++i )
+        {
+            int level = levelOf(keys[i]);
+            if ( level == 0 ) {
+                // a view into the image, nothing to compute or cache
+                cv::Rect r(columnOf(keys[i]) * m_tileSize, rowOf(keys[i]) * m_tileSize, m_tileSize, m_tileSize);
+                tiles[i] = image(r & cv::Rect(0, 0, image.cols, image.rows));
+                continue;
+            }
+            tiles[i] = generation == m_generation ? lookup(keys[i]) : cv::Mat();
+            if ( tiles[i].empty() ) {
+                missing.push_back(i);
+            }
+        }
+    }
+    if ( missing.empty() ) {
+        return tiles;
+    }
+
+    // the tiles of a request have disjoint children, so no tile is computed twice; the calling thread
+    // takes the last one and the nested children are computed the same way
+    TaskGroup group;
+    for ( size_t m=0; m+1<missing.size(); ++m ) {
+        size_t i = missing[m];
+        group.run([this, &tiles, &keys, &image, generation, i]{
+            tiles[i] = compute(keys[i], image, generation);
+        });
+    }
+    size_t last = missing.back();
+    tiles[last] = compute(keys[last], image, generation);
+    group.wait();
+    return tiles;
+}
+
+cv::Mat TilePyramid::compute(Key key, const cv::Mat& image, quint64 generation)
+{
+    VIDEN_TRACE_SCOPE("tile");
+    const int level = levelOf(key);
+    const int x = columnOf(key);
+    const int y = rowOf(key);
+    const int half = m_tileSize / 2;
+
+    cv::Size size = levelSizeOf(image.size(), level);
+    cv::Rect area = cv::Rect(x * m_tileSize, y * m_tileSize, m_tileSize, m_tileSize) & cv::Rect(0, 0, size.width, size.height);
+    cv::Mat out(area.height, area.width, image.type());
+
+    if ( level == 1 ) {
+        cv::Rect src = cv::Rect(2 * area.x, 2 * area.y, 2 * m_tileSize, 2 * m_tileSize) & cv::Rect(0, 0, image.cols, image.rows);
+        cv::resize(image(src), out, out.size(), 0, 0, cv::INTER_AREA);
+    }
+    else {
+        cv::Size childSize = levelSizeOf(image.size(), level-1);
+        std::vector<Key> children;
+        for ( int cy=2*y; cy<=2*y+1; ++cy ) {
+            for ( int cx=2*x; cx<=2*x+1; ++cx ) {
+                if ( cx * m_tileSize < childSize.width && cy * m_tileSize < childSize.height ) {
+                    children.push_back( makeKey(level-1, cx, cy) );
+                }
+            }
+        }
+        std::vector<cv::Mat> childTiles = produce(children, image, generation);
+        for ( size_t i=0; i<children.size(); ++i )
+        {
+            const cv::Mat& child = childTiles[i];
+            cv::Rect quadrant((columnOf(children[i]) - 2*x) * half, (rowOf(children[i]) - 2*y) * half,
+                              (child.cols + 1) / 2, (child.rows + 1) / 2);
+            cv::Mat dst = out(quadrant & cv::Rect(0, 0, out.cols, out.rows));
+            cv::resize(child, dst, dst.size(), 0, 0, cv::INTER_AREA);
+        }
+    }
+    insert(key, out, generation);
+    return out;
+}
+
+cv::Mat TilePyramid::lookup(Key key)
+{
+    std::unordered_map<Key, Lru::iterator>::iterator it = m_index.find(key);
+    if ( it == m_index.end() ) {
+        return cv::Mat();
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->image;
+}
+
+void TilePyramid::insert(Key key, const cv::Mat& tile, quint64 generation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if ( generation != m_generation || m_index.count(key) ) {
+        return; // a tile of the previous image, or computed meanwhile by another request
+    }
+    m_computed++;
+    Entry entry;
+    entry.key = key;
+    entry.image = tile;
+    m_lru.push_front(entry);
+    m_index[key] = m_lru.begin();
+    m_bytes += tile.total() * tile.elemSize();
+    evict();
+}
+
+void TilePyramid::evict()
+{
+    while ( m_bytes > m_budget && ! m_lru.empty() )
+    {
+        const Entry& entry = m_lru.back();
+        m_bytes -= entry.image.total() * entry.image.elemSize();
+        m_index.erase(entry.key);
+        m_lru.pop_back();
+    }
+}
+
+cv::Size TilePyramid::levelSizeOf(const cv::Size& imageSize, int level) const
+{
+    return cv::Size( (imageSize.width + (1 << level) - 1) >> level, (imageSize.height + (1 << level) - 1) >> level );
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
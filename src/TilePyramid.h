@@ -0,0 +1,190 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+/** ***********************************************************************************************
+ * @file TilePyramid.h
+ * @brief Lazily built multi resolution tiles of a huge image for zoom and pan, with an LRU tile cache.
+ */
+
+// Qt
+#include <QtGlobal>
+
+// cv
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The TilePyramid class hands out the tiles of an image which cover a viewport at the level
+ *        of detail of the zoom factor, so zoom and pan cost is proportional to the viewport.
+ *
+ *        Level 0 is the image itself, level k halves level k-1. A tile has tileSize() x tileSize()
+ *        pixels of its level (less at the right and bottom border). Level 0 tiles are views into the
+ *        image without copies. A tile of level k > 0 is computed on demand from its 2x2 children at
+ *        level k-1 (INTER_AREA), so a zoomed out view touches each image pixel once and later views
+ *        reuse the cached tiles. Missing tiles are computed in parallel on the Executor.
+ *
+ *        The computed tiles are kept in an LRU cache bounded by a memory budget, tiles returned to the
+ *        caller stay valid when they are evicted (cv::Mat reference counting).
+ *        @code
+ *        // slot of ImagePlayer::newFrame()
+ *        m_pyramid.setImage(frame.clone());
+ *        // paint event, viewport in image coordinates
+ *        std::vector<TilePyramid::Tile> tiles = m_pyramid.request(viewport, zoom);
+ *        for ( ... ) draw tile.image scaled into tile.rect * zoom
+ *        @endcode
+ *        All functions can be called from any thread.
+ */
+class TilePyramid
+{
+public:
+    static const int DEFAULT_TILE_SIZE = 256;
+    static const size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+    struct Tile
+    {
+        int level;
+        int x;          // column of the tile in its level
+        int y;          // row of the tile in its level
+        cv::Rect rect;  // covered area in image (level 0) pixels
+        cv::Mat image;
+    };
+
+    /**
+     * @brief TilePyramid
+     * @param tileSize edge of a tile, rounded up to a power of two, at least 16
+     * @param budgetBytes max memory of the cached tiles
+     */
+    explicit TilePyramid(int tileSize=DEFAULT_TILE_SIZE, size_t budgetBytes=DEFAULT_BUDGET);
+
+    /**
+     * @brief setImage start a new pyramid, the cache of the previous image is dropped. Nothing is
+     *        computed until tiles are requested.
+     * @param image any type which cv::resize supports. It is shared, not copied, and must not be
+     *        modified while the pyramid uses it, e.g. clone a frame of a player which reuses its buffer.
+     */
+    void setImage(const cv::Mat& image);
+
+    void clear();
+
+    /**
+     * @brief levelFor level whose resolution matches the zoom best without being coarser
+     * @param zoom display pixels per image pixel, e.g. 0.1 gives level 3 (1/8)
+     */
+    int levelFor(double zoom) const;
+
+    /**
+     * @brief request the tiles covering the viewport at the level of the zoom factor
+     * @param viewport visible area in image (level 0) pixels, clipped to the image
+     * @param zoom display pixels per image pixel
+     * @return tiles row by row, empty if there is no image
+     */
+    std::vector<Tile> request(const cv::Rect& viewport, double zoom);
+
+    /**
+     * @brief tile a single tile, computed if not cached
+     * @param level 0..levels()-1
+     * @param x column, 0..columns(level)-1
+     * @param y row, 0..rows(level)-1
+     * @return empty Mat for an invalid position
+     */
+    cv::Mat tile(int level, int x, int y);
+
+    //! Number of levels, the last one fits into one tile
+    int levels() const;
+
+    //! Size of a level in pixels
+    cv::Size levelSize(int level) const;
+
+    int columns(int level) const;
+
+    int rows(int level) const;
+
+    inline int tileSize() const;
+
+    void setBudget(size_t budgetBytes);
+
+    inline size_t budget() const;
+
+    //! Memory of the cached tiles
+    size_t cachedBytes() const;
+
+    //! Tiles computed since setImage(), each one once unless evicted
+    inline quint64 computedTiles() const;
+
+private:
+    typedef quint64 Key;
+    struct Entry
+    {
+        Key key;
+        cv::Mat image;
+    };
+    typedef std::list<Entry> Lru;
+
+    TilePyramid(const TilePyramid&);
+    TilePyramid& operator=(const TilePyramid&);
+
+    static inline Key makeKey(int level, int x, int y);
+
+    //! Tiles of the keys, cached or computed in parallel
+    std::vector<cv::Mat> produce(const std::vector<Key>& keys, const cv::Mat& image, quint64 generation);
+
+    //! Compute one tile of level > 0 from its children
+    cv::Mat compute(Key key, const cv::Mat& image, quint64 generation);
+
+    //! Cached tile or empty, moves it to the front of the LRU list. Locked by the caller.
+    cv::Mat lookup(Key key);
+
+    void insert(Key key, const cv::Mat& tile, quint64 generation);
+
+    //! Drop least recently used tiles until the budget is kept. Locked by the caller.
+    void evict();
+
+    cv::Size levelSizeOf(const cv::Size& imageSize, int level) const;
+
+    int m_tileSize;
+    int m_tileShift;
+    size_t m_budget;
+    cv::Mat m_image;
+    int m_levels;
+    quint64 m_generation;   // incremented by setImage(), tiles of older images are not cached
+    quint64 m_computed;
+
+    mutable std::mutex m_mutex;
+    Lru m_lru;              // most recently used first
+    std::unordered_map<Key, Lru::iterator> m_index;
+    size_t m_bytes;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+int TilePyramid::tileSize() const
+{
+    return m_tileSize;
+}
+
+size_t TilePyramid::budget() const
+{
+    return m_budget;
+}
+
+quint64 TilePyramid::computedTiles() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_computed;
+}
+
+TilePyramid::Key TilePyramid::makeKey(int level, int x, int y)
+{
+    return (static_cast<quint64>(level) << 56) | (static_cast<quint64>(x) << 28) | static_cast<quint64>(y);
+}
+
+}
+#endif // TILEPYRAMID_H
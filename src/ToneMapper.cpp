@@ -0,0 +1,105 @@
+#include "ToneMapper.h"
+
+// oscv
+#include "OcvUtils.h"
+#include "Tracer.h"
+
+// cv
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <cmath>
+
+using namespace oscv;
+
+
+ToneMapper::ToneMapper(double filterMin, double filterMax)
+    : m_filterMin(filterMin)
+    , m_filterMax(filterMax)
+    , m_low(0.0)
+    , m_high(255.0)
+    , m_rate(0.2)
+    , m_updateInterval(5)
+    , m_frameCount(0)
+    , m_automatic(true)
+    , m_initialized(false)
+    , m_lutDepth(-1)
+    , m_lutLow(0.0)
+    , m_lutHigh(0.0)
+{
+}
+
+bool ToneMapper::map(const cv::Mat& frame, cv::Mat& out)
+{
+    if ( frame.empty() ) {
+        return false;
+    }
+    VIDEN_TRACE_SCOPE("tone_map");
+    if ( m_automatic && (! m_initialized || m_frameCount % m_updateInterval == 0) ) {
+        update(frame);
+    }
+    m_frameCount++;
+
+    const int depth = frame.depth();
+    if ( depth != CV_8U && depth != CV_8S && depth != CV_16U && depth != CV_16S ) {
+        OcvUtils::applyStretch(frame, out, m_low, m_high);
+        return true;
+    }
+    // half an output level of the current table
+    double tolerance = 0.5 * (m_lutHigh - m_lutLow) / 255.0;
+    if ( depth != m_lutDepth || std::fabs(m_low - m_lutLow) > tolerance || std::fabs(m_high - m_lutHigh) > tolerance )
+    {
+        OcvUtils::stretchLut(depth, m_low, m_high, 0, 255, m_lut);
+        m_lutDepth = depth;
+        m_lutLow = m_low;
+        m_lutHigh = m_high;
+    }
+    OcvUtils::applyLut(frame, out, m_lut);
+    return true;
+}
+
+void ToneMapper::setRange(double low, double high)
+{
+    m_low = low;
+    m_high = high > low ? high : low + 1.0;
+    m_automatic = false;
+    m_initialized = true;
+}
+
+void ToneMapper::reset()
+{
+    m_automatic = true;
+    m_initialized = false;
+    m_frameCount = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////PRIVATE/////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ToneMapper::update(const cv::Mat& frame)
+{
+    // nearest neighbour keeps the values, the percentiles of the subsample are close enough
+    const cv::Mat* sample = &frame;
+    if ( frame.cols > SAMPLE_WIDTH ) {
+        int height = std::max(1, frame.rows * SAMPLE_WIDTH / frame.cols);
+        cv::resize(frame, m_sample, cv::Size(SAMPLE_WIDTH, height), 0, 0, cv::INTER_NEAREST);
+        sample = &m_sample;
+    }
+    double low, high;
+    if ( ! OcvUtils::stretchRange(*sample, low, high, m_filterMin, m_filterMax) ) {
+        return;
+    }
+    if ( ! m_initialized ) {
+        m_low = low;
+        m_high = high;
+        m_initialized = true;
+        return;
+    }
+    m_low += m_rate * (low - m_low);
+    m_high += m_rate * (high - m_high);
+    if ( m_high <= m_low ) {
+        m_high = m_low + 1.0;
+    }
+}
+
+/////////////////////////////////////////////END OF FILE//////////////////////////////////////////////////////
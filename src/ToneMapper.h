@@ -0,0 +1,151 @@
+#ifndef TONEMAPPER_H
+#define TONEMAPPER_H
+
+/** ***********************************************************************************************
+ * @file ToneMapper.h
+ * @brief Display mapping of 16 bit and float frames to 8 bit with a range adapted over time.
+ */
+
+// cv
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The ToneMapper class maps frames of any depth to 8 bit for display, frame after frame.
+ *
+ *        The display range is the percentile range of OcvUtils::stretchRange(), but it is not recomputed
+ *        for every frame: every updateInterval() frames the range of a subsampled frame (at most
+ *        SAMPLE_WIDTH pixels wide) is measured and the current range moves towards it by the
+ *        adaptation rate, which also avoids flicker. 8 and 16 bit frames are mapped through a lookup
+ *        table (OcvUtils::applyLut), which is only rebuilt when the range moved by more than half an
+ *        output level. Other depths go through OcvUtils::applyStretch.
+ *        @code
+ *        ToneMapper mapper;
+ *        mapper.map(thermalFrame, display);   // CV_16UC1 in, CV_8UC1 out
+ *        @endcode
+ *        8 bit frames are mapped too, use isNeeded() to skip them.
+ */
+class ToneMapper
+{
+public:
+    static const int SAMPLE_WIDTH = 256;
+
+    /**
+     * @brief ToneMapper
+     * @param filterMin percent of the darkest pixels mapped to black
+     * @param filterMax percent of the brightest pixels mapped to white
+     */
+    explicit ToneMapper(double filterMin=0.5, double filterMax=0.5);
+
+    /**
+     * @brief map a frame to 8 bit and update the range if due
+     * @param frame any depth and number of channels
+     * @param out[out] CV_8U with the channels of frame, reused if it has the right size
+     * @return false if the frame is empty
+     */
+    bool map(const cv::Mat& frame, cv::Mat& out);
+
+    //! True if frames of this depth need a mapping for display, i.e. not 8 bit unsigned
+    static inline bool isNeeded(const cv::Mat& frame);
+
+    /**
+     * @brief setRange fix the range, the automatic update stops until reset()
+     * @param low value mapped to 0
+     * @param high value mapped to 255, > low
+     */
+    void setRange(double low, double high);
+
+    //! Measure the range from the next frame again and adapt it automatically
+    void reset();
+
+    inline double low() const;
+
+    inline double high() const;
+
+    inline bool isAutomatic() const;
+
+    /**
+     * @brief setAdaptation fraction of the distance to the measured range which the range moves per
+     *        update, 1 jumps to it
+     * @param rate 0 < rate <= 1
+     */
+    inline void setAdaptation(double rate);
+
+    //! Measure the range every n-th frame, at least 1
+    inline void setUpdateInterval(int frames);
+
+    inline int updateInterval() const;
+
+    inline void setClipPercent(double filterMin, double filterMax);
+
+private:
+    //! Measure the range of a subsample of frame and move towards it
+    void update(const cv::Mat& frame);
+
+    double m_filterMin;
+    double m_filterMax;
+    double m_low;
+    double m_high;
+    double m_rate;
+    int m_updateInterval;
+    int m_frameCount;
+    bool m_automatic;
+    bool m_initialized;
+
+    cv::Mat m_sample;
+    std::vector<uchar> m_lut;
+    int m_lutDepth;        // depth the table is built for, -1 if none
+    double m_lutLow;
+    double m_lutHigh;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool ToneMapper::isNeeded(const cv::Mat& frame)
+{
+    return frame.depth() != CV_8U;
+}
+
+double ToneMapper::low() const
+{
+    return m_low;
+}
+
+double ToneMapper::high() const
+{
+    return m_high;
+}
+
+bool ToneMapper::isAutomatic() const
+{
+    return m_automatic;
+}
+
+void ToneMapper::setAdaptation(double rate)
+{
+    m_rate = rate > 0.0 && rate <= 1.0 ? rate : 1.0;
+}
+
+void ToneMapper::setUpdateInterval(int frames)
+{
+    m_updateInterval = frames > 1 ? frames : 1;
+}
+
+int ToneMapper::updateInterval() const
+{
+    return m_updateInterval;
+}
+
+void ToneMapper::setClipPercent(double filterMin, double filterMax)
+{
+    m_filterMin = filterMin;
+    m_filterMax = filterMax;
+}
+
+}
+#endif // TONEMAPPER_H
@@ -0,0 +1,283 @@
+#include "Tracer.h"
+
+// Qt
+#include <QFile>
+#include <QByteArray>
+#include <QCoreApplication>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+using namespace oscv;
+
+
+std::atomic<bool> Tracer::s_enabled(false);
+
+namespace
+{
+    const size_t RING_SIZE = 4096;      // events per thread, power of two
+    // Slots of a ring which only end events may use, so that every recorded begin gets its end.
+    // A thread has at most this many scopes open in the trace, deeper ones are dropped whole.
+    const size_t END_RESERVE = 256;
+    const int FLUSH_INTERVAL_MS = 20;
+
+    struct Event
+    {
+        const char* name;
+        quint64 ns;
+        char phase;                     // 'B', 'E' or 'i'
+    };
+
+    struct ThreadBuffer
+    {
+        Event events[RING_SIZE];
+        std::atomic<size_t> head;       // written by the owning thread
+        std::atomic<size_t> tail;       // written by the flusher
+        std::atomic<const char*> name;
+        std::atomic<bool> exited;       // the owning thread has ended, head does not change anymore
+        bool nameWritten;               // flusher only
+        int tid;
+
+        ThreadBuffer(int id, const char* threadName)
+            : head(0), tail(0), name(threadName), exited(false), nameWritten(false), tid(id)
+        {
+        }
+    };
+
+    // The ring of a thread, marked as exited when the thread ends so that the flusher can drop it
+    struct ThreadRing
+    {
+        ~ThreadRing()
+        {
+            if ( buffer ) {
+                buffer->exited.store(true, std::memory_order_release);
+            }
+        }
+
+        std::shared_ptr<ThreadBuffer> buffer;
+    };
+
+    thread_local ThreadRing t_ring;
+    thread_local const char* t_threadName = nullptr;
+    thread_local size_t t_openScopes = 0;   // begin events in the ring without their end yet
+
+    struct TraceState;
+    void drain(TraceState& s, bool write);
+
+    // Registry of the thread rings, they outlive their threads until the flusher has drained them
+    struct TraceState
+    {
+        ~TraceState()
+        {
+            // trace still running at exit: finish the file instead of terminating on the joinable thread
+            if ( flusher.joinable() ) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stop = true;
+                    wake.notify_all();
+                }
+                flusher.join();
+                drain(*this, true);
+                file.write("\n]}\n");
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector< std::shared_ptr<ThreadBuffer> > buffers;
+        std::thread flusher;
+        QFile file;
+        bool stop = false;
+        bool firstEvent = true;
+        int nextTid = 1;
+        quint64 startNs = 0;
+        std::atomic<quint64> dropped{0};
+    };
+
+    TraceState& state()
+    {
+        static TraceState s;
+        return s;
+    }
+
+    inline quint64 nowNs()
+    {
+        return static_cast<quint64>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch()).count() );
+    }
+
+    // The ring of the calling thread, created on the first event
+    ThreadBuffer& threadBuffer()
+    {
+        std::shared_ptr<ThreadBuffer>& buffer = t_ring.buffer;
+        if ( ! buffer ) {
+            TraceState& s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            buffer = std::make_shared<ThreadBuffer>(s.nextTid++, t_threadName);
+            s.buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    /**
+     * @brief record append an event to the ring of the calling thread
+     * @param reserve slots which must stay free after the event
+     * @return false if the event was dropped
+     */
+    bool record(const char* name, char phase, size_t reserve)
+    {
+        ThreadBuffer& b = threadBuffer();
+        size_t head = b.head.load(std::memory_order_relaxed);
+        if ( head - b.tail.load(std::memory_order_acquire) + reserve >= RING_SIZE ) {
+            state().dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Event& e = b.events[head & (RING_SIZE-1)];
+        e.name = name;
+        e.ns = nowNs();
+        e.phase = phase;
+        b.head.store(head+1, std::memory_order_release);
+        return true;
+    }
+
+    // Called with the state mutex locked
+    void drain(TraceState& s, bool write)
+    {
+        QByteArray out;
+        qint64 pid = QCoreApplication::applicationPid();
+        for ( size_t i=0; i<s.buffers.size(); )
+        {
+            ThreadBuffer& b = *s.buffers[i];
+            bool exited = b.exited.load(std::memory_order_acquire); // before head, which is final then
+            size_t tail = b.tail.load(std::memory_order_relaxed);
+            size_t head = b.head.load(std::memory_order_acquire);
+            const char* name = b.name.load(std::memory_order_relaxed);
+            if ( write && name && ! b.nameWritten ) {
+                out.append(s.firstEvent ? "\n" : ",\n");
+                out.append( QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":\"%3\"}}")
+                            .arg(pid).arg(b.tid).arg(QString::fromLatin1(name)).toLatin1() );
+                b.nameWritten = true;
+                s.firstEvent = false;
+            }
+            for ( ; write && tail != head; ++tail )
+            {
+                const Event& e = b.events[tail & (RING_SIZE-1)];
+                quint64 ns = e.ns > s.startNs ? e.ns - s.startNs : 0;
+                out.append(s.firstEvent ? "\n" : ",\n");
+                out.append( QString("{\"name\":\"%1\",\"cat\":\"viden\",\"ph\":\"%2\",\"ts\":%3.%4,\"pid\":%5,\"tid\":%6%7}")
+                            .arg(QString::fromLatin1(e.name)).arg(QChar(e.phase))
+                            .arg(ns / 1000).arg(ns % 1000, 3, 10, QChar('0'))
+                            .arg(pid).arg(b.tid).arg(QLatin1String(e.phase == 'i' ? ",\"s\":\"t\"" : "")).toLatin1() );
+                s.firstEvent = false;
+            }
+            b.tail.store(head, std::memory_order_release);
+            if ( exited ) {
+                s.buffers.erase(s.buffers.begin() + i); // drained, nothing more will come
+            }
+            else {
+                ++i;
+            }
+        }
+        if ( ! out.isEmpty() ) {
+            s.file.write(out);
+        }
+    }
+
+    void flushLoop()
+    {
+        TraceState& s = state();
+        std::unique_lock<std::mutex> lock(s.mutex);
+        while ( ! s.stop ) {
+            s.wake.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+            drain(s, true);
+        }
+    }
+}
+
+
+bool Tracer::start(const QString& fileName)
+{
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if ( s_enabled.load() || s.flusher.joinable() ) {
+        return false;
+    }
+    s.file.setFileName(fileName);
+    if ( ! s.file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        return false;
+    }
+    drain(s, false); // events recorded while the last trace was stopped
+    for ( size_t i=0; i<s.buffers.size(); ++i ) {
+        s.buffers[i]->nameWritten = false;
+    }
+    s.file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    s.firstEvent = true;
+    s.stop = false;
+    s.startNs = nowNs();
+    s.dropped.store(0);
+    s.flusher = std::thread(flushLoop);
+    s_enabled.store(true);
+    return true;
+}
+
+void Tracer::stop()
+{
+    TraceState& s = state();
+    s_enabled.store(false);
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if ( ! s.flusher.joinable() ) {
+            return;
+        }
+        s.stop = true;
+        s.wake.notify_all();
+    }
+    s.flusher.join();
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    drain(s, true);
+    s.file.write("\n]}\n");
+    s.file.close();
+}
+
+void Tracer::setThreadName(const char* name)
+{
+    t_threadName = name;
+    if ( t_ring.buffer ) {
+        t_ring.buffer->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+bool Tracer::begin(const char* name)
+{
+    // the reserve keeps a slot for the end of every open scope
+    if ( t_openScopes >= END_RESERVE || ! record(name, 'B', END_RESERVE) ) {
+        return false;
+    }
+    t_openScopes++;
+    return true;
+}
+
+void Tracer::end(const char* name)
+{
+    if ( t_openScopes > 0 ) {
+        t_openScopes--;
+    }
+    record(name, 'E', 0);
+}
+
+void Tracer::instant(const char* name)
+{
+    record(name, 'i', END_RESERVE);
+}
+
+quint64 Tracer::droppedEvents()
+{
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
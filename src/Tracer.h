@@ -0,0 +1,131 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+/** ***********************************************************************************************
+ * @file Tracer.h
+ * @brief Timeline of the player and extraction threads as a Chrome trace file (chrome://tracing,
+ *        https://ui.perfetto.dev).
+ *
+ *        Built with VIDEN_ENABLE_TRACING=0 (CMake option VIDEN_ENABLE_TRACING) the VIDEN_TRACE_*
+ *        macros expand to nothing.
+ */
+
+// Qt
+#include <QString>
+#include <QtGlobal>
+
+#include <atomic>
+
+#ifndef VIDEN_ENABLE_TRACING
+#define VIDEN_ENABLE_TRACING 1
+#endif
+
+
+namespace oscv
+{
+
+/**
+ * @brief The Tracer class records begin/end events of named scopes from all threads.
+ *
+ *        Tracing is off until start() is called, a disabled scope costs one relaxed atomic load.
+ *        Each thread writes into its own lock-free ring buffer (single producer, single consumer),
+ *        a background thread drains the rings into the file every few milliseconds. A ring is created
+ *        with the first event of a thread and released when the thread has ended and its events are
+ *        written. Events which do not fit into a full ring are dropped and counted, the recording
+ *        threads never block. A scope is dropped as a whole, the begin and end events stay paired.
+ *        Event and thread names must be string literals or otherwise outlive the trace.
+ */
+class Tracer
+{
+public:
+    /**
+     * @brief start write the events of all threads to the given file until stop() is called
+     * @param fileName trace file in Chrome JSON format, e.g. viden.trace.json
+     * @return false if tracing is already running or the file cannot be written
+     */
+    static bool start(const QString& fileName);
+
+    /**
+     * @brief stop write the remaining events and close the file
+     */
+    static void stop();
+
+    static inline bool isEnabled();
+
+    /**
+     * @brief setThreadName name of the calling thread in the trace viewer, cheap while tracing is off
+     * @param name e.g. "ImagePlayer"
+     */
+    static void setThreadName(const char* name);
+
+    /**
+     * @brief begin a scope
+     * @return false if the event was dropped, end() must only be called after true
+     */
+    static bool begin(const char* name);
+
+    static void end(const char* name);
+
+    //! Event without duration, e.g. a cache miss
+    static void instant(const char* name);
+
+    //! Events lost because a ring was full, since start()
+    static quint64 droppedEvents();
+
+    /**
+     * @brief The Scope class records a begin event at construction and the end event at destruction
+     */
+    class Scope
+    {
+    public:
+        inline explicit Scope(const char* name);
+        inline ~Scope();
+    private:
+        const char* m_name;
+    };
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool Tracer::isEnabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+Tracer::Scope::Scope(const char* name)
+    : m_name(nullptr)
+{
+    if ( Tracer::isEnabled() && Tracer::begin(name) ) {
+        m_name = name;
+    }
+}
+
+Tracer::Scope::~Scope()
+{
+    if ( m_name ) {
+        Tracer::end(m_name);
+    }
+}
+
+}
+
+
+#define VIDEN_TRACE_CAT_(a, b) a##b
+#define VIDEN_TRACE_CAT(a, b) VIDEN_TRACE_CAT_(a, b)
+
+#if VIDEN_ENABLE_TRACING
+//! Trace the rest of the enclosing scope under the given name
+#define VIDEN_TRACE_SCOPE(name) oscv::Tracer::Scope VIDEN_TRACE_CAT(videnTraceScope, __LINE__)(name)
+//! Trace an event without duration
+#define VIDEN_TRACE_INSTANT(name) do { if ( oscv::Tracer::isEnabled() ) oscv::Tracer::instant(name); } while (0)
+#define VIDEN_TRACE_THREAD_NAME(name) oscv::Tracer::setThreadName(name)
+#else
+#define VIDEN_TRACE_SCOPE(name) ((void)0)
+#define VIDEN_TRACE_INSTANT(name) ((void)0)
+#define VIDEN_TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif // TRACER_H
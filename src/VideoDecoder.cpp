@@ -0,0 +1,79 @@
+#include "VideoDecoder.h"
+
+// oscv
+#include "VideoUtils.h"
+#include "VideoDefs.h"
+
+using namespace oscv;
+
+
+VideoDecoder::VideoDecoder()
+    : m_capture(NULL)
+{
+}
+
+VideoDecoder::~VideoDecoder()
+{
+    close();
+}
+
+bool VideoDecoder::open(const QString& filename)
+{
+    close();
+    m_capture = new cv::VideoCapture( filename.toStdString() );
+    if ( ! m_capture->isOpened() ) {
+        close();
+        return false;
+    }
+    m_name = filename;
+    return true;
+}
+
+void VideoDecoder::close()
+{
+    if ( m_capture ) {
+        m_capture->release();
+        delete m_capture;
+        m_capture = NULL;
+    }
+    m_name.clear();
+}
+
+bool VideoDecoder::read(cv::Mat& frame)
+{
+    if ( m_capture == NULL ) {
+        return false;
+    }
+    return m_capture->read(frame) && frame.data;
+}
+
+bool VideoDecoder::grab()
+{
+    return m_capture != NULL && m_capture->grab();
+}
+
+bool VideoDecoder::seek(int frameNumber)
+{
+    if ( frameNumber <= VideoDefs::INVALID_FRAME_NUMBER || frameNumber >= frameCount() ) {
+        return false;
+    }
+    return VideoUtils::setCurrentFrame(m_capture, frameNumber);
+}
+
+int VideoDecoder::position() const
+{
+    return static_cast<int>( VideoUtils::getCurrentFrame(m_capture) );
+}
+
+int VideoDecoder::frameCount() const
+{
+    return static_cast<int>( VideoUtils::getNumberOfFrames(m_capture) );
+}
+
+double VideoDecoder::frameRate() const
+{
+    return VideoUtils::getFrameRate(m_capture);
+}
+
+
+///////////////////////////////////////////////////END OF FILE////////////////////////////////////////////
@@ -0,0 +1,75 @@
+#ifndef VIDEODECODER_H
+#define VIDEODECODER_H
+
+/** ***********************************************************************************************
+ * @file VideoDecoder.h
+ * @brief Frames of a video file with cv::VideoCapture.
+ */
+
+// oscv
+#include "Decoder.h"
+
+// cv
+#include <opencv2/highgui/highgui.hpp>
+
+
+namespace oscv
+{
+
+/**
+ * @brief The VideoDecoder class IDecoder for video files
+ */
+class VideoDecoder : public IDecoder
+{
+public:
+    VideoDecoder();
+
+    ~VideoDecoder();
+
+    bool open(const QString& filename);
+
+    void close();
+
+    inline bool isOpen() const;
+
+    bool read(cv::Mat& frame);
+
+    bool grab();
+
+    bool seek(int frameNumber);
+
+    int position() const;
+
+    int frameCount() const;
+
+    double frameRate() const;
+
+    inline QString name() const;
+
+    //! The capture, null if not open
+    inline cv::VideoCapture* capture() const;
+
+private:
+    cv::VideoCapture* m_capture;
+    QString m_name;
+};
+
+///////////////////////////////////////////////IMPLEMENTATION/////////////////////////////////////////
+
+bool VideoDecoder::isOpen() const
+{
+    return m_capture != NULL;
+}
+
+QString VideoDecoder::name() const
+{
+    return m_name;
+}
+
+cv::VideoCapture* VideoDecoder::capture() const
+{
+    return m_capture;
+}
+
+}
+#endif // VIDEODECODER_H
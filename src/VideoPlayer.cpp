@@ -14,7 +14,12 @@
 #include "VideoPlayer.h"
 #include "VideoUtils.h"
 #include "TimeUtils.h"
+#include "Tracer.h"
 #include "ImageUtils.h"
+#include "OcvUtils.h"
+
+#include <algorithm>
+#include <cmath>
 
 
 using namespace oscv;
@@ -27,11 +32,25 @@ VideoPlayer::VideoPlayer(QObject *parent) :
     QThread(parent)
     , m_stop(true)
     , m_isNewVideoLoaded(false)
-    , m_Capture(NULL)
     , m_name("")
     , m_speed(Speed::Fast)
+    , m_stabilize(false)
+    , m_gated(false)
+    , m_stage(NULL)
+    , m_proxyEnabled(false)
+    , m_active(&m_decoder)
 {
      qRegisterMetaType<cv::Mat>("cv::Mat");
+     qRegisterMetaType<PlayerMetrics::Snapshot>("oscv::PlayerMetrics::Snapshot");
+
+     m_refineTimer.setSingleShot(true);
+     m_refineTimer.setInterval(REFINE_DELAY_MS);
+     connect(&m_refineTimer, &QTimer::timeout, this, &VideoPlayer::refine);
+     m_proxyBuilder.setFinishedHandler([this](ProxyBuilder::State state) {
+         if ( state == ProxyBuilder::State::Done ) {
+             QMetaObject::invokeMethod(this, "attachProxy", Qt::QueuedConnection);
+         }
+     });
 
 }
 
@@ -41,39 +60,44 @@ VideoPlayer::~VideoPlayer()
 {
     m_mutex.lock();
     m_stop = true;
-    if (m_Capture != NULL) {
-        m_Capture->release();
-        delete m_Capture;
-    }
-
     m_waitCondition.wakeOne();
     //condition.wakeAll();
     m_mutex.unlock();
     wait();
+    m_proxyBuilder.cancel();
+    m_proxyBuilder.wait();
+    m_proxy.close();
+    m_decoder.close();
 
 }
 
 // Load video to the memory
 bool VideoPlayer::open(QString filename)
 {
-    if ( m_Capture ) {
-        delete m_Capture;
-    }
-    m_Capture  =  new cv::VideoCapture( filename.toStdString() );
-    if ( ! m_Capture->isOpened() ) {
+    m_refineTimer.stop();
+    m_proxyBuilder.cancel();
+    m_proxyBuilder.wait(); // at most the frames of one task
+    m_mutex.lock();
+    m_proxy.close();
+    m_active = &m_decoder;
+    m_mutex.unlock();
+
+    if ( ! m_decoder.open(filename) ) {
         return false;
     }
 
     m_name = filename;
     m_frameRate = getFrameRate();
+    m_stabilizer.reset();
     m_isNewVideoLoaded = true;
     int initFrameNr = 0; // initial image frame to display a video content
     setCurrentFrame( initFrameNr );
     if ( readFrame() )
     {
-        m_variant.setValue( m_frame );
-        emit newFrame( m_variant, getCurrentFrame() );
+        m_sourceSize = m_frame.size();
+        emitSingleFrame();
         //setCurrentFrame( 1 );
+        startProxy();
         return true;
     }
     return false;
@@ -127,30 +151,98 @@ void VideoPlayer::stop(bool stop)
 void VideoPlayer::run()
 {
 
+    VIDEN_TRACE_THREAD_NAME("VideoPlayer");
     bool ok = true;
     int delay = static_cast<int>(m_speed) /m_frameRate;
     while( !m_stop )
     {
-        m_mutex.lock();
-        ok = readFrame();
+#if VIDEN_ENABLE_METRICS
+        quint64 frameStart = PlayerMetrics::now();
+#endif
+        VIDEN_METRICS_LOCK(m_metrics, m_mutex);
+        {
+            VIDEN_METRICS_SCOPE(m_metrics, Decode);
+            ok = decodeFrame();
+        }
         m_mutex.unlock();
 
         if ( ! ok  ) {
-            m_mutex.lock();
+            VIDEN_METRICS_LOCK(m_metrics, m_mutex);
             m_stop = true;
+            ProcessingStage* stage = m_stage;
             m_mutex.unlock();
+            if ( stage ) {
+                emitProcessed(stage, true); // the frames still in the stage
+            }
             emit donePlay(m_stop);
         }
         if ( ! m_stop ) {
-             m_mutex.lock();
+             VIDEN_METRICS_LOCK(m_metrics, m_mutex);
              delay = static_cast<int>(m_speed)/m_frameRate;
-             m_variant.setValue( m_frame );
-             m_mutex.unlock();
-             emit newFrame( m_variant, getCurrentFrame() );
+             if ( m_stabilize ) {
+                 VIDEN_METRICS_SCOPE(m_metrics, Process);
+                 if ( OcvUtils::isShared(m_stabilized) ) {
+                     m_stabilized.release(); // the last emitted frame, receivers may still read it
+                 }
+                 m_stabilizer.stabilize(m_frame, m_stabilized);
+             }
+             const cv::Mat& frame = m_stabilize ? m_stabilized : m_frame;
+             bool skip = false;
+             if ( m_gated ) {
+                 VIDEN_METRICS_SCOPE(m_metrics, Process);
+                 skip = ! m_changeGate.accept(frame);
+             }
+             ProcessingStage* stage = m_stage;
+             if ( skip ) {
+                 m_mutex.unlock();
+                 VIDEN_METRICS_COUNT(m_metrics, Skipped);
+             }
+             else if ( stage ) {
+                 stage->push(frame, getCurrentFrame()); // copies, the stage is never full here
+                 m_mutex.unlock();
+                 emitProcessed(stage, false);
+             }
+             else {
+                 {
+                     VIDEN_METRICS_SCOPE(m_metrics, Wrap);
+                     m_variant.setValue( frame );
+                 }
+                 m_mutex.unlock();
+                 VIDEN_METRICS_SCOPE(m_metrics, Emit);
+                 VIDEN_TRACE_SCOPE("emit");
+                 emit newFrame( m_variant, getCurrentFrame() );
+             }
+#if VIDEN_ENABLE_METRICS
+             if ( ! skip ) {
+                 m_metrics.frameDone(frameStart, delay); // gated frames only count as Skipped
+             }
+             if ( m_metrics.reportDue() ) {
+                 emit metricsUpdated( m_metrics.snapshot() );
+             }
+#endif
+        }
+        VIDEN_METRICS_SCOPE(m_metrics, Sleep);
+        VIDEN_TRACE_SCOPE("sleep");
+        if ( delay > 0 ) {
+            sleepMiliSecond(delay);
+        }
+        else {
+            yieldCurrentThread(); // Speed::Fast, let the other streams have the core
         }
-        sleepMiliSecond(delay);
 
     }
+
+    m_mutex.lock();
+    ProcessingStage* stage = ok ? m_stage : NULL; // stopped, a failed read has drained it already
+    m_mutex.unlock();
+    if ( stage ) {
+        emitProcessed(stage, true); // the frames still in the stage
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if ( m_active == &m_proxy ) {
+        QMetaObject::invokeMethod(this, "refine", Qt::QueuedConnection); // paused on a proxy frame
+    }
 }
 
 
@@ -159,26 +251,33 @@ bool VideoPlayer::go(int relativeFrame)
     m_mutex.lock();
     m_stop=true;
     int frameNumber = getCurrentFrame()+relativeFrame;
+    // jumps are read from the proxy at constant seek time, refine() follows when they stop
+    bool scrub = relativeFrame != 1 && canUseProxy(frameNumber);
     m_mutex.unlock();
 
     if ( frameNumber <= VideoDefs::INVALID_FRAME_NUMBER || frameNumber >= getNumberOfFrames() )
         return false;
 
+    m_mutex.lock();
+    m_active = scrub ? &m_proxy : &m_decoder; // setCurrentFrame() seeks it
+    m_mutex.unlock();
     bool ok = setCurrentFrame(frameNumber);
 
     if ( ok && m_stop == true)
     {
         m_mutex.lock();
+        m_stabilizer.reset(); // not consecutive to the previous frame anymore
+        VIDEN_TRACE_SCOPE("seek");
         ok = readFrame();
         m_mutex.unlock();
         if (ok )
         {
-            m_mutex.lock();
-            m_variant.setValue( m_frame );
-            m_mutex.unlock();
-            emit newFrame( m_variant, getCurrentFrame() );
+            emitSingleFrame();
         }
     }
+    if ( scrub ) {
+        m_refineTimer.start();
+    }
     return ok;
 
 }
@@ -190,25 +289,25 @@ bool VideoPlayer::setCurrentFrame( int frameNumber )
     if (frameNumber <= VideoDefs::INVALID_FRAME_NUMBER || frameNumber >= getNumberOfFrames() ) {
         return false;
     }
-    return VideoUtils::setCurrentFrame(m_Capture, frameNumber);
+    return m_active->seek(frameNumber);
 }
 
 
 int VideoPlayer::getCurrentFrame() const
 {
-    return (int) VideoUtils::getCurrentFrame(m_Capture)-1;
+    return m_active->position()-1;
 }
 
 
 int VideoPlayer::getNumberOfFrames() const
 {
-    return (int) (VideoUtils::getNumberOfFrames(m_Capture)-1);
+    return m_decoder.frameCount()-1;
 }
 
 
 int VideoPlayer::getFrameRate() const
 {
-    return (int) VideoUtils::getFrameRate(m_Capture);
+    return (int) m_decoder.frameRate();
 }
 
 void VideoPlayer::setSpeed(Speed speed)
@@ -218,6 +317,89 @@ void VideoPlayer::setSpeed(Speed speed)
 
 }
 
+void VideoPlayer::setProcessingStage(ProcessingStage* stage)
+{
+    QMutexLocker locker(&m_mutex);
+    if ( m_stage ) {
+        m_stage->clear();
+    }
+    m_stage = stage;
+}
+
+void VideoPlayer::setChangeGate(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_gated = enable;
+    m_changeGate.reset();
+}
+
+void VideoPlayer::setStabilization(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stabilize = enable;
+    m_stabilizer.reset();
+}
+
+void VideoPlayer::setProxyEnabled(bool enable, const QString& directory)
+{
+    m_mutex.lock();
+    m_proxyEnabled = enable;
+    m_proxyDirectory = directory;
+    m_mutex.unlock();
+    if ( enable ) {
+        if ( ! hasProxy() ) {
+            startProxy();
+        }
+        return;
+    }
+    m_refineTimer.stop();
+    m_proxyBuilder.cancel();
+    refine(); // a paused proxy frame
+    QMutexLocker locker(&m_mutex);
+    useDecoder(&m_decoder);
+    m_proxy.close();
+}
+
+void VideoPlayer::attachProxy()
+{
+    QMutexLocker locker(&m_mutex);
+    QString proxy = ProxyBuilder::proxyPath(m_name, m_proxyDirectory);
+    if ( ! m_proxyEnabled || m_proxy.isOpen() || ! ProxyBuilder::isUpToDate(m_name, proxy) ) {
+        return;
+    }
+    if ( ! m_proxy.open(proxy) ) {
+        return;
+    }
+    // the source identity has been checked, this also catches a foreign or damaged proxy file
+    double width = m_proxy.capture()->get(CV_CAP_PROP_FRAME_WIDTH);
+    double height = m_proxy.capture()->get(CV_CAP_PROP_FRAME_HEIGHT);
+    double aspect = static_cast<double>(m_sourceSize.width) / std::max(1, m_sourceSize.height);
+    if ( m_proxy.frameCount() <= 0 || width <= 0 || height <= 0
+         || std::abs(width / height - aspect) > 0.05 * aspect ) {
+        m_proxy.close();
+        return;
+    }
+    locker.unlock();
+    emit proxyReady(proxy);
+}
+
+void VideoPlayer::refine()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if ( ! m_stop || m_active != &m_proxy ) {
+            return;
+        }
+        int frameNumber = getCurrentFrame();
+        m_active = &m_decoder;
+        VIDEN_TRACE_SCOPE("refine");
+        if ( ! m_decoder.seek(frameNumber) || ! readFrame() ) {
+            return;
+        }
+    }
+    emitSingleFrame();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///                              PRIVATE FUNCTIONS
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -226,14 +408,106 @@ void VideoPlayer::setSpeed(Speed speed)
 // Read next frame
 bool VideoPlayer::readFrame()
 {
-    if ( m_Capture == NULL ) {
+    if ( m_active != &m_proxy ) {
+        return m_decoder.read(m_frame);
+    }
+    if ( ! m_proxy.read(m_proxyFrame) ) {
         return false;
-    }    
-    if ( m_Capture->read(m_frame) && m_frame.data ) {
-        return true;
     }
-    return false;
+    cv::resize(m_proxyFrame, m_frame, m_sourceSize, 0, 0, cv::INTER_LINEAR);
+    return true;
+}
+
+// The decoding of all players shares the cores of the executor instead of running on a thread each
+bool VideoPlayer::decodeFrame()
+{
+    bool fast = static_cast<int>(m_speed) < static_cast<int>(Speed::Normal);
+    VideoDecoder* decoder = fast && canUseProxy(m_active->position()) ? &m_proxy : &m_decoder;
+    bool ok = false;
+    m_decodeTasks.run([this, decoder, &ok]
+    {
+        VIDEN_TRACE_SCOPE("decode");
+        useDecoder(decoder);
+        ok = readFrame();
+    });
+    m_decodeTasks.wait();
+    return ok;
+}
+
+void VideoPlayer::startProxy()
+{
+    if ( ! m_proxyEnabled || m_name.isEmpty() ) {
+        return;
+    }
+    QString proxy = ProxyBuilder::proxyPath(m_name, m_proxyDirectory);
+    if ( ProxyBuilder::isUpToDate(m_name, proxy) ) {
+        attachProxy();
+    }
+    else if ( m_proxyBuilder.source() != m_name || m_proxyBuilder.state() != ProxyBuilder::State::Building ) {
+        m_proxyBuilder.start(m_name, proxy);
+    }
+}
 
+bool VideoPlayer::canUseProxy(int frameNumber) const
+{
+    return m_proxy.isOpen() && ! m_sourceSize.empty()
+        && frameNumber >= 0 && frameNumber < m_proxy.frameCount();
+}
+
+void VideoPlayer::useDecoder(VideoDecoder* decoder)
+{
+    if ( m_active == decoder ) {
+        return;
+    }
+    int next = m_active->position();
+    m_active = decoder;
+    m_active->seek(next);
+}
+
+// Emit m_frame after open() or go(), through the processing stage if there is one
+void VideoPlayer::emitSingleFrame()
+{
+    m_mutex.lock();
+    if ( m_gated ) {
+        m_changeGate.reset(); // the played frames are compared with this one
+        m_changeGate.accept(m_frame);
+    }
+    ProcessingStage* stage = m_stage;
+    if ( stage ) {
+        stage->clear(); // frames of the old position
+        stage->push(m_frame, getCurrentFrame());
+    }
+    else {
+        m_variant.setValue( m_frame );
+    }
+    m_mutex.unlock();
+    if ( stage ) {
+        emitProcessed(stage, true);
+    }
+    else {
+        emit newFrame( m_variant, getCurrentFrame() );
+    }
+}
+
+// Emit the filtered frames which are ready, all if drain is set, at least one if the stage is full
+void VideoPlayer::emitProcessed(ProcessingStage* stage, bool drain)
+{
+    cv::Mat result;
+    int frameNumber;
+    while ( stage->inFlight() > 0 && (drain || stage->isFull() || stage->isReady()) )
+    {
+        if ( ! stage->pop(result, frameNumber) ) {
+            break; // all dropped by the filter
+        }
+        {
+            VIDEN_METRICS_LOCK(m_metrics, m_mutex);
+            m_variant.setValue( result );
+            m_mutex.unlock();
+        }
+        VIDEN_METRICS_SCOPE(m_metrics, Emit);
+        VIDEN_TRACE_SCOPE("emit");
+        emit newFrame( m_variant, frameNumber );
+    }
 }
 
 
@@ -13,6 +13,7 @@
 #include <QWaitCondition>
 #include <QMetaType>
 #include <QVariant>
+#include <QTimer>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -20,12 +21,19 @@
 
 #include "Player.h"
 #include "VideoUtils.h"
+#include "VideoDecoder.h"
+#include "FrameStabilizer.h"
+#include "ChangeGate.h"
+#include "PlayerMetrics.h"
+#include "ProcessingStage.h"
+#include "ProxyBuilder.h"
+#include "Executor.h"
 
 
 namespace oscv
 {
 /**
- * @brief The VideoPlayer class Player for video file
+ * @brief The VideoPlayer class Player for video file. Qt adapter of VideoDecoder, which does the decoding.
  */
 
 
@@ -36,6 +44,9 @@ class VideoPlayer : public QThread, public IPlayer
 
 public:
 
+     //! Time without go() after which the full resolution frame replaces the proxy frame
+     static const int REFINE_DELAY_MS = 200;
+
      //! Constructor
      VideoPlayer(QObject *parent = 0);
 
@@ -85,6 +96,75 @@ public:
      //! Set speed of the player
      void setSpeed(Speed speed);
 
+     /**
+      * @brief setStabilization emit frames warped towards a smoothed camera path while playing.
+      *        @see FrameStabilizer. Frames emitted by open() and go() are not warped.
+      * @param enable
+      */
+     void setStabilization(bool enable);
+
+     inline bool isStabilized() const;
+
+     inline FrameStabilizer& stabilizer();
+
+     /**
+      * @brief setChangeGate emit only frames which differ from the last emitted one while playing,
+      *        the playback timing stays the same. Suppressed frames count as PlayerMetrics::Skipped.
+      *        @see ChangeGate. Frames emitted by open() and go() always pass.
+      * @param enable
+      */
+     void setChangeGate(bool enable);
+
+     inline bool isChangeGated() const;
+
+     inline ChangeGate& changeGate();
+
+     /**
+      * @brief setProcessingStage run a filter on several frames at the same time before they are
+      *        emitted. newFrame() then carries the filter results in frame order, delayed by the
+      *        frames in flight. @see ProcessingStage
+      * @param stage not owned, must outlive the player. Null emits the decoded frames.
+      */
+     void setProcessingStage(ProcessingStage* stage);
+
+     inline ProcessingStage* processingStage() const;
+
+     /**
+      * @brief metrics time per stage of the playback loop and frame counters, @see PlayerMetrics.
+      *        Set a report interval to get metricsUpdated() while playing.
+      */
+     inline PlayerMetrics& metrics();
+
+     /**
+      * @brief setProxyEnabled show frames of a low resolution all-intra proxy while scrubbing with go()
+      *        and while playing faster than Speed::Normal, so seeking takes the same short time
+      *        everywhere in the video. The proxy frames are scaled up to the size of the video.
+      *        When the player is paused or the jumps stop for REFINE_DELAY_MS, the frame is decoded
+      *        again from the video. Steps with go(1) always decode the video.
+      *
+      *        An up to date proxy is used right away, otherwise it is built in the background
+      *        (@see ProxyBuilder) and proxyReady() is emitted when it can be used.
+      * @param enable
+      * @param directory of the proxy files, the directory of the video if empty
+      */
+     void setProxyEnabled(bool enable, const QString& directory=QString());
+
+     inline bool isProxyEnabled() const;
+
+     //! True if the proxy of the open video is in use
+     inline bool hasProxy() const;
+
+     //! True if the last frame came from the proxy
+     inline bool isOnProxy() const;
+
+     inline ProxyBuilder& proxyBuilder();
+
+     /**
+      * @brief setPriority executor priority class of the decoding while playing, e.g. Low for a
+      *        preview player next to the main one. @see Executor
+      */
+     inline void setPriority(Executor::Priority priority);
+
      //! Get current video/image frame
      inline const cv::Mat& getRawFrame() const {
 
@@ -98,15 +178,44 @@ signals:
     //! To application
     void donePlay(bool done);
 
+    //! Emitted from the player thread every PlayerMetrics::reportInterval() ms while playing
+    void metricsUpdated(const oscv::PlayerMetrics::Snapshot& snapshot);
+
+    //! The proxy of the open video has been opened
+    void proxyReady(const QString& proxy);
+
 protected:
     //! Override QThread
      void run();
 
 
+private slots:
+     //! Open the proxy of the open video if it is up to date
+     void attachProxy();
+
+     //! Replace a proxy frame shown while paused with the full resolution frame
+     void refine();
+
 private:
      //! Read frame
      bool readFrame();
 
+     //! Read the next frame while playing in a task on the executor, m_mutex is locked
+     bool decodeFrame();
+
+     //! Build or attach the proxy of the open video
+     void startProxy();
+
+     //! True if the proxy is open and has the given frame, m_mutex is locked
+     bool canUseProxy(int frameNumber) const;
+
+     //! Continue reading from the given decoder at the same position, m_mutex is locked
+     void useDecoder(VideoDecoder* decoder);
+
+     void emitSingleFrame();
+
+     void emitProcessed(ProcessingStage* stage, bool drain);
+
 
 private:
     /*! True if video is playing but suddenly receiving a stop signal. Or video is prepared for initialized.
@@ -131,8 +240,8 @@ private:
     //! Video file name
     QString m_name;
 
-    //! Video capture
-    cv::VideoCapture *m_Capture;
+    //! Video decoder of the core engine
+    VideoDecoder m_decoder;
 
     //! CV Mat as RGB frame
     cv::Mat m_RGBframe;
@@ -147,6 +256,47 @@ private:
 
     QVariant m_variant;
 
+    //! True if the frames are stabilized while playing
+    bool m_stabilize;
+
+    FrameStabilizer m_stabilizer;
+
+    //! Warped frame, emitted instead of m_frame if m_stabilize is set
+    cv::Mat m_stabilized;
+
+    //! True if static frames are not emitted while playing
+    bool m_gated;
+
+    ChangeGate m_changeGate;
+
+    PlayerMetrics m_metrics;
+
+    //! Optional filter between decoding and emitting, not owned
+    ProcessingStage* m_stage;
+
+    bool m_proxyEnabled;
+
+    QString m_proxyDirectory;
+
+    //! Decoder of the proxy, open when the proxy is ready
+    VideoDecoder m_proxy;
+
+    //! m_decoder or m_proxy, the one which the frames are read from
+    VideoDecoder* m_active;
+
+    //! Frame as read from the proxy, scaled to m_sourceSize into m_frame
+    cv::Mat m_proxyFrame;
+
+    cv::Size m_sourceSize;
+
+    ProxyBuilder m_proxyBuilder;
+
+    //! Started by go() on the proxy, refine() when it fires
+    QTimer m_refineTimer;
+
+    //! The decoding while playing, the player thread only paces the frames
+    TaskGroup m_decodeTasks;
+
 };
 
 ///////////////////////////////////////IMPLEMENTATION///////////////////////////////////////
@@ -162,6 +312,61 @@ QString VideoPlayer::name() const
     return m_name;
 }
 
+bool VideoPlayer::isStabilized() const
+{
+    return m_stabilize;
+}
+
+FrameStabilizer& VideoPlayer::stabilizer()
+{
+    return m_stabilizer;
+}
+
+bool VideoPlayer::isChangeGated() const
+{
+    return m_gated;
+}
+
+ChangeGate& VideoPlayer::changeGate()
+{
+    return m_changeGate;
+}
+
+ProcessingStage* VideoPlayer::processingStage() const
+{
+    return m_stage;
+}
+
+PlayerMetrics& VideoPlayer::metrics()
+{
+    return m_metrics;
+}
+
+bool VideoPlayer::isProxyEnabled() const
+{
+    return m_proxyEnabled;
+}
+
+bool VideoPlayer::hasProxy() const
+{
+    return m_proxy.isOpen();
+}
+
+bool VideoPlayer::isOnProxy() const
+{
+    return m_active == &m_proxy;
+}
+
+ProxyBuilder& VideoPlayer::proxyBuilder()
+{
+    return m_proxyBuilder;
+}
+
+void VideoPlayer::setPriority(Executor::Priority priority)
+{
+    m_decodeTasks.setPriority(priority);
+}
+
 
 
 } // end namespace
@@ -4,8 +4,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 // Qt
-#include <QApplication>
-#include <QVector>
+#include <QCoreApplication>
 // oscv
 #include "ProgressBar.h"
 #include "Definitions.h"
@@ -13,6 +12,13 @@
 #include "ImageDefs.h"
 #include "FileUtils.h"
 #include "StringUtils.h"
+#include "Tracer.h"
+#include "FrameExtractor.h"
+#include "ImageWriter.h"
+#include "VideoDecoder.h"
+#include "HashIndex.h"
+
+#include <algorithm>
 
 using namespace oscv;
 using namespace cv;
@@ -20,15 +26,19 @@ using namespace cv;
 bool VideoUtils::VidToImg(const QString& vidFile,
                           const QString& imgDir,
                           const QString& imgPrefix,
-                          IProgressBar* progress)
+                          IProgressBar* progress,
+                          bool skipStatic,
+                          HashIndex* hashes)
 {
-
-    VideoCapture* capture  =  new VideoCapture( vidFile.toStdString() );
-    if ( ! capture->isOpened() ) {
+    FrameExtractor extractor;
+    if ( ! extractor.open(vidFile) ) {
         return false;
     }
+    extractor.setChangeGate(skipStatic);
 
-    double numberOfFrame = getNumberOfFramesWithLimit( capture );
+    VideoDecoder* video = dynamic_cast<VideoDecoder*>( extractor.decoder() );
+    double numberOfFrame = video ? getNumberOfFramesWithLimit( video->capture() )
+                                 : std::min(extractor.decoder()->frameCount(), static_cast<int>(VideoDefs::MAX_NUMBER_OF_FRAMES));
     if (progress) {
         progress->setMaximum(numberOfFrame);
     }
@@ -36,16 +46,19 @@ bool VideoUtils::VidToImg(const QString& vidFile,
     QString filename(imgDir);
     getPathWithSeparator(filename);
 
-    QVector<int> params;
-    //params.push_back(CV_IMWRITE_PNG_COMPRESSION);
-    //params.push_back(16);
-    params.push_back(CV_IMWRITE_JPEG_QUALITY);
-    params.push_back(95);
+    // headless use has no application object, there are no events to process then
+    const bool processEvents = QCoreApplication::instance() != NULL;
+
+    // the frames are encoded on the executor (JPEG quality 95), write() copies the decoder's buffer
+    ImageWriter writer;
 
+    FrameHash hasher;
+    if ( hashes ) {
+        hashes->addClip(vidFile);
+    }
 
-    Mat frame;
     bool ok = true;
-    for( uint i=0;i<numberOfFrame;i++)
+    extractor.run([&](const cv::Mat& frame, int i) -> bool
     {
         QString num;
         beautifyNumberToString(i, 4, num); // allow for 4 digits number, max is 9999
@@ -59,22 +72,25 @@ bool VideoUtils::VidToImg(const QString& vidFile,
         }
 
         // Allow GUI to be able to perform update or redraw
-        QApplication::processEvents();
+        if ( processEvents ) {
+            QCoreApplication::processEvents();
+        }
 
-        // Reading video..
-        if( capture->read(frame) && frame.data ) {
-            imwrite(str.toStdString(), frame, params.toStdVector());
+        if ( hashes ) {
+            VIDEN_TRACE_SCOPE("hash");
+            hashes->add(i, hasher.compute(frame));
         }
+
+        writer.write(str, frame, ImageWriter::Preset::Jpeg);
         if (progress) {
             if ( progress->wasCanceled() ) {
                 ok = false;
-                break;
+                return false;
             }
         }
-    } // end for loop
+        return true;
+    }, 0, static_cast<int>(numberOfFrame)-1);
 
-    // Ok, done. Release the video capture
-    capture->release();
-    delete capture;
-    return ok;
+    // a video which ends early because of decoding errors is not converted
+    return writer.flush() && ok && ! extractor.wasTruncated();
 }